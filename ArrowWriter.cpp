@@ -0,0 +1,582 @@
+#include "ArrowWriter.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const char FILE_MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+    const uint32_t CONTINUATION = 0xFFFFFFFF;
+    // every buffer and message starts at a multiple of this in the file
+    const size_t ALIGNMENT = 8;
+
+    // flatbuffer union tags and enums of the Arrow format (Schema.fbs, Message.fbs)
+    const int16_t METADATA_V5 = 4;
+    const uint8_t HEADER_SCHEMA = 1;
+    const uint8_t HEADER_DICTIONARY_BATCH = 2;
+    const uint8_t HEADER_RECORD_BATCH = 3;
+    const uint8_t TYPE_INT = 2;
+    const uint8_t TYPE_FLOATING_POINT = 3;
+    const uint8_t TYPE_UTF8 = 5;
+    const uint8_t TYPE_LIST = 12;
+    const int16_t PRECISION_SINGLE = 1;
+    const int16_t PRECISION_DOUBLE = 2;
+
+    /**
+     * @brief Builds one flatbuffer back to front, the way the flatbuffers library does: children are
+     * finished before the tables referring to them, so every offset points forward in the final buffer
+     *
+     * Sizes and object positions are counted from the end of the buffer. The bytes are kept reversed
+     * until finish so adding to the front is a push_back.
+     */
+    class FlatBuilder {
+        public:
+            FlatBuilder() {
+                _alignment = 4;
+                _tableStart = 0;
+            }
+
+            uint32_t getSize() const {
+                return (uint32_t)_reversed.size();
+            }
+
+            // add zeros so that after the given number of bytes the size is a multiple of the alignment
+            void prepare(size_t alignment, size_t additional) {
+                _alignment = max(_alignment, alignment);
+                _reversed.insert(_reversed.end(), (alignment - (_reversed.size() + additional) % alignment) % alignment, 0);
+            }
+
+            // always little endian, whatever the host
+            template <typename T>
+            void pushRaw(T value) {
+                uint64_t bits = (uint64_t)value;
+                for (size_t i = sizeof(T); i > 0; i--) {
+                    _reversed.push_back((uint8_t)(bits >> (8 * (i - 1))));
+                }
+            }
+
+            template <typename T>
+            uint32_t push(T value) {
+                prepare(sizeof(T), 0);
+                pushRaw(value);
+                return getSize();
+            }
+
+            uint32_t pushOffset(uint32_t target) {
+                prepare(4, 0);
+                pushRaw<uint32_t>(getSize() + 4 - target);
+                return getSize();
+            }
+
+            uint32_t createString(const string& value) {
+                prepare(4, value.size() + 1);
+                _reversed.push_back(0);
+                for (size_t i = value.size(); i > 0; i--) {
+                    _reversed.push_back((uint8_t)value[i - 1]);
+                }
+                pushRaw<uint32_t>((uint32_t)value.size());
+                return getSize();
+            }
+
+            uint32_t createOffsetVector(const vector<uint32_t>& targets) {
+                prepare(4, targets.size() * 4);
+                for (size_t i = targets.size(); i > 0; i--) {
+                    pushOffset(targets[i - 1]);
+                }
+                pushRaw<uint32_t>((uint32_t)targets.size());
+                return getSize();
+            }
+
+            // a vector of structs made only of 8-byte words (smaller fields are written as a padded word)
+            uint32_t createStructVector(const vector<int64_t>& words, size_t wordsPerStruct) {
+                prepare(8, words.size() * 8);
+                for (size_t i = words.size(); i > 0; i--) {
+                    pushRaw<int64_t>(words[i - 1]);
+                }
+                pushRaw<uint32_t>((uint32_t)(words.size() / wordsPerStruct));
+                return getSize();
+            }
+
+            void startTable() {
+                _slots.clear();
+                _tableStart = getSize();
+            }
+
+            template <typename T>
+            void addScalar(size_t slot, T value) {
+                setSlot(slot, push(value));
+            }
+
+            void addOffset(size_t slot, uint32_t target) {
+                setSlot(slot, pushOffset(target));
+            }
+
+            // write the table's vtable just before it and point the table at it
+            uint32_t endTable() {
+                uint32_t table = push<int32_t>(0);
+                for (size_t i = _slots.size(); i > 0; i--) {
+                    pushRaw<uint16_t>((uint16_t)(_slots[i - 1] == 0 ? 0 : table - _slots[i - 1]));
+                }
+                pushRaw<uint16_t>((uint16_t)(table - _tableStart));
+                pushRaw<uint16_t>((uint16_t)((_slots.size() + 2) * 2));
+                uint32_t vtable = getSize();
+
+                uint32_t distance = vtable - table;
+                for (size_t i = 0; i < 4; i++) {
+                    _reversed[table - 1 - i] = (uint8_t)(distance >> (8 * i));
+                }
+                return table;
+            }
+
+            vector<uint8_t> finish(uint32_t root) {
+                prepare(_alignment, 4);
+                pushOffset(root);
+                return vector<uint8_t>(_reversed.rbegin(), _reversed.rend());
+            }
+
+        private:
+            void setSlot(size_t slot, uint32_t position) {
+                if (_slots.size() <= slot) {
+                    _slots.resize(slot + 1, 0);
+                }
+                _slots[slot] = position;
+            }
+
+            vector<uint8_t> _reversed;
+            size_t _alignment;
+            uint32_t _tableStart;
+            vector<uint32_t> _slots;
+    };
+
+    bool isSigned(ArrowWriter::Type type) {
+        return type == ArrowWriter::Type::Int8 || type == ArrowWriter::Type::Int16 || type == ArrowWriter::Type::Int32 || type == ArrowWriter::Type::Int64;
+    }
+
+    bool isFloatingPoint(ArrowWriter::Type type) {
+        return type == ArrowWriter::Type::Float32 || type == ArrowWriter::Type::Float64;
+    }
+
+    uint32_t buildIntType(FlatBuilder& builder, ArrowWriter::Type type) {
+        builder.startTable();
+        builder.addScalar<int32_t>(0, (int32_t)(ArrowWriter::getWidth(type) * 8));
+        builder.addScalar<uint8_t>(1, isSigned(type) ? 1 : 0);
+        return builder.endTable();
+    }
+
+    // the type table of a column's values, with its union tag
+    uint32_t buildType(FlatBuilder& builder, ArrowWriter::Type type, uint8_t& tag) {
+        if (type == ArrowWriter::Type::Utf8) {
+            tag = TYPE_UTF8;
+            builder.startTable();
+            return builder.endTable();
+        }
+        if (isFloatingPoint(type)) {
+            tag = TYPE_FLOATING_POINT;
+            builder.startTable();
+            builder.addScalar<int16_t>(0, type == ArrowWriter::Type::Float32 ? PRECISION_SINGLE : PRECISION_DOUBLE);
+            return builder.endTable();
+        }
+        tag = TYPE_INT;
+        return buildIntType(builder, type);
+    }
+
+    uint32_t buildField(FlatBuilder& builder, const string& name, uint8_t tag, uint32_t type, uint32_t dictionary, const vector<uint32_t>& children) {
+        uint32_t nameOffset = builder.createString(name);
+        uint32_t childrenOffset = builder.createOffsetVector(children);
+        builder.startTable();
+        builder.addOffset(0, nameOffset);
+        builder.addScalar<uint8_t>(1, 0);
+        builder.addScalar<uint8_t>(2, tag);
+        builder.addOffset(3, type);
+        if (dictionary != 0) {
+            builder.addOffset(4, dictionary);
+        }
+        builder.addOffset(5, childrenOffset);
+        return builder.endTable();
+    }
+
+    // the schema table, with dictionary ids numbered by column
+    uint32_t buildSchema(FlatBuilder& builder, const vector<ArrowWriter::Field>& fields) {
+        vector<uint32_t> fieldOffsets;
+        for (size_t i = 0; i < fields.size(); i++) {
+            const ArrowWriter::Field& field = fields[i];
+            uint8_t tag = 0;
+            uint32_t type = 0;
+            uint32_t dictionary = 0;
+            vector<uint32_t> children;
+            if (!field.dictionary.empty()) {
+                uint32_t indexType = buildIntType(builder, field.type);
+                builder.startTable();
+                builder.addScalar<int64_t>(0, (int64_t)i);
+                builder.addOffset(1, indexType);
+                builder.addScalar<uint8_t>(2, 0);
+                dictionary = builder.endTable();
+                type = buildType(builder, ArrowWriter::Type::Utf8, tag);
+            } else if (field.list) {
+                uint8_t itemTag = 0;
+                uint32_t itemType = buildType(builder, field.type, itemTag);
+                children.push_back(buildField(builder, "item", itemTag, itemType, 0, vector<uint32_t>()));
+                tag = TYPE_LIST;
+                builder.startTable();
+                type = builder.endTable();
+            } else {
+                type = buildType(builder, field.type, tag);
+            }
+            fieldOffsets.push_back(buildField(builder, field.name, tag, type, dictionary, children));
+        }
+
+        uint16_t probe = 1;
+        uint8_t firstByte = 0;
+        memcpy(&firstByte, &probe, 1);
+        uint32_t fieldVector = builder.createOffsetVector(fieldOffsets);
+        builder.startTable();
+        builder.addScalar<int16_t>(0, firstByte == 1 ? 0 : 1);
+        builder.addOffset(1, fieldVector);
+        return builder.endTable();
+    }
+
+    // a RecordBatch table: one node per array and two or three buffers per array, all in column order
+    uint32_t buildRecordBatch(FlatBuilder& builder, int64_t rows, const vector<int64_t>& nodes, const vector<int64_t>& buffers) {
+        uint32_t nodeVector = builder.createStructVector(nodes, 2);
+        uint32_t bufferVector = builder.createStructVector(buffers, 2);
+        builder.startTable();
+        builder.addScalar<int64_t>(0, rows);
+        builder.addOffset(1, nodeVector);
+        builder.addOffset(2, bufferVector);
+        return builder.endTable();
+    }
+
+    vector<uint8_t> buildMessage(FlatBuilder& builder, uint8_t headerType, uint32_t header, int64_t bodyLength) {
+        builder.startTable();
+        builder.addScalar<int16_t>(0, METADATA_V5);
+        builder.addScalar<uint8_t>(1, headerType);
+        builder.addOffset(2, header);
+        builder.addScalar<int64_t>(3, bodyLength);
+        return builder.finish(builder.endTable());
+    }
+
+    size_t padded(size_t size) {
+        return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+}
+
+/**
+ * @brief Construct a column of values, or of lists of values
+ *
+ */
+ArrowWriter::Field::Field(const string& fieldName, Type fieldType, bool isList) {
+    name = fieldName;
+    type = fieldType;
+    list = isList;
+}
+
+/**
+ * @brief Construct a column of indexes into the given strings
+ *
+ */
+ArrowWriter::Field::Field(const string& fieldName, Type indexType, const vector<string>& values) {
+    name = fieldName;
+    type = indexType;
+    list = false;
+    dictionary = values;
+}
+
+/**
+ * @brief Construct a closed ArrowWriter
+ *
+ */
+ArrowWriter::ArrowWriter() {
+    _file = nullptr;
+    _position = 0;
+    _failed = false;
+    _rowCount = 0;
+}
+
+/**
+ * @brief Close the file if it is still open
+ *
+ */
+ArrowWriter::~ArrowWriter() {
+    close();
+}
+
+/**
+ * @brief Create the file and write the schema and dictionaries of the given columns
+ *
+ * @return bool whether the file could be created
+ */
+bool ArrowWriter::open(const string& path, const vector<Field>& fields) {
+    close();
+    for (size_t i = 0; i < fields.size(); i++) {
+        // lists of strings and lists of dictionary indexes are not needed by anything written yet
+        if (fields[i].list && (fields[i].type == Type::Utf8 || !fields[i].dictionary.empty())) {
+            return false;
+        }
+        if (!fields[i].dictionary.empty() && (isFloatingPoint(fields[i].type) || fields[i].type == Type::Utf8)) {
+            return false;
+        }
+    }
+
+    _file = fopen(path.c_str(), "wb");
+    if (_file == nullptr) {
+        return false;
+    }
+    _position = 0;
+    _failed = false;
+    _fields = fields;
+    _dictionaryBlocks.clear();
+    _batchBlocks.clear();
+    _rowCount = 0;
+
+    writeBytes(FILE_MAGIC, sizeof(FILE_MAGIC));
+    writePadding();
+
+    FlatBuilder builder;
+    Block block;
+    writeMessage(buildMessage(builder, HEADER_SCHEMA, buildSchema(builder, _fields), 0), vector<Buffer>(), 0, block);
+    writeDictionaries();
+    return !_failed;
+}
+
+/**
+ * @brief Check whether a file is open
+ *
+ * @return bool
+ */
+bool ArrowWriter::isOpen() const {
+    return _file != nullptr;
+}
+
+/**
+ * @brief Append a record batch of the given number of rows, one Column per field
+ *
+ * @return bool whether the batch was written
+ */
+bool ArrowWriter::writeBatch(size_t rows, const vector<Column>& columns) {
+    if (_file == nullptr || _failed || columns.size() != _fields.size()) {
+        return false;
+    }
+
+    // lay out every buffer of every column one after another in the body, each padded to the alignment
+    vector<int64_t> nodes;
+    vector<int64_t> bufferWords;
+    vector<Buffer> buffers;
+    int64_t bodyLength = 0;
+    auto addBuffer = [&](const void* data, size_t length) {
+        buffers.push_back({data, bodyLength, (int64_t)length});
+        bufferWords.push_back(bodyLength);
+        bufferWords.push_back((int64_t)length);
+        bodyLength += (int64_t)padded(length);
+    };
+    for (size_t i = 0; i < _fields.size(); i++) {
+        const Field& field = _fields[i];
+        const Column& column = columns[i];
+        if ((field.list || field.type == Type::Utf8) && column.offsets == nullptr) {
+            return false;
+        }
+        nodes.push_back((int64_t)rows);
+        nodes.push_back(0);
+        addBuffer(nullptr, 0);
+        if (field.type == Type::Utf8) {
+            addBuffer(column.offsets, (rows + 1) * sizeof(int32_t));
+            addBuffer(column.values, rows == 0 ? 0 : (size_t)column.offsets[rows]);
+        } else if (field.list) {
+            size_t valueCount = rows == 0 ? 0 : (size_t)column.offsets[rows];
+            addBuffer(column.offsets, (rows + 1) * sizeof(int32_t));
+            nodes.push_back((int64_t)valueCount);
+            nodes.push_back(0);
+            addBuffer(nullptr, 0);
+            addBuffer(column.values, valueCount * getWidth(field.type));
+        } else {
+            addBuffer(column.values, rows * getWidth(field.type));
+        }
+    }
+
+    FlatBuilder builder;
+    uint32_t batch = buildRecordBatch(builder, (int64_t)rows, nodes, bufferWords);
+    Block block;
+    if (!writeMessage(buildMessage(builder, HEADER_RECORD_BATCH, batch, bodyLength), buffers, bodyLength, block)) {
+        return false;
+    }
+    _batchBlocks.push_back(block);
+    _rowCount += rows;
+    return true;
+}
+
+/**
+ * @brief Get the number of rows written so far
+ *
+ * @return uint64_t
+ */
+uint64_t ArrowWriter::getRowCount() const {
+    return _rowCount;
+}
+
+/**
+ * @brief Write the footer that makes the file readable and close it
+ *
+ * @return bool whether everything was written
+ */
+bool ArrowWriter::close() {
+    if (_file == nullptr) {
+        return false;
+    }
+
+    // end of the stream, then the footer repeating the schema and listing where every batch is
+    const uint32_t endOfStream[2] = {CONTINUATION, 0};
+    writeBytes(endOfStream, sizeof(endOfStream));
+
+    FlatBuilder builder;
+    vector<int64_t> dictionaryWords;
+    vector<int64_t> batchWords;
+    for (const Block& block : _dictionaryBlocks) {
+        dictionaryWords.insert(dictionaryWords.end(), {block.offset, (int64_t)block.metadataLength, block.bodyLength});
+    }
+    for (const Block& block : _batchBlocks) {
+        batchWords.insert(batchWords.end(), {block.offset, (int64_t)block.metadataLength, block.bodyLength});
+    }
+    uint32_t schema = buildSchema(builder, _fields);
+    uint32_t dictionaries = builder.createStructVector(dictionaryWords, 3);
+    uint32_t batches = builder.createStructVector(batchWords, 3);
+    builder.startTable();
+    builder.addScalar<int16_t>(0, METADATA_V5);
+    builder.addOffset(1, schema);
+    builder.addOffset(2, dictionaries);
+    builder.addOffset(3, batches);
+    vector<uint8_t> footer = builder.finish(builder.endTable());
+
+    int32_t footerLength = (int32_t)footer.size();
+    writeBytes(footer.data(), footer.size());
+    writeBytes(&footerLength, sizeof(footerLength));
+    writeBytes(FILE_MAGIC, sizeof(FILE_MAGIC));
+
+    bool written = !_failed && fclose(_file) == 0;
+    _file = nullptr;
+    return written;
+}
+
+/**
+ * @brief Get the size in bytes of one value of a type (0 for strings)
+ *
+ * @return size_t
+ */
+size_t ArrowWriter::getWidth(Type type) {
+    switch (type) {
+        case Type::Int8:
+        case Type::UInt8:
+            return 1;
+        case Type::Int16:
+        case Type::UInt16:
+            return 2;
+        case Type::Int32:
+        case Type::UInt32:
+        case Type::Float32:
+            return 4;
+        case Type::Int64:
+        case Type::UInt64:
+        case Type::Float64:
+            return 8;
+        case Type::Utf8:
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Write one message (metadata followed by its body) and give its location in the file
+ *
+ * @return bool whether it was written
+ */
+bool ArrowWriter::writeMessage(const vector<uint8_t>& metadata, const vector<Buffer>& buffers, int64_t bodyLength, Block& block) {
+    // the continuation marker and length are part of the metadata, which is padded so the body stays aligned
+    int32_t metadataLength = (int32_t)(padded(8 + metadata.size()) - 8);
+    block.offset = (int64_t)_position;
+    block.metadataLength = metadataLength + 8;
+    block.bodyLength = bodyLength;
+
+    writeBytes(&CONTINUATION, sizeof(CONTINUATION));
+    writeBytes(&metadataLength, sizeof(metadataLength));
+    writeBytes(metadata.data(), metadata.size());
+    writePadding();
+
+    // the buffers go out exactly as the caller holds them
+    uint64_t bodyStart = _position;
+    for (const Buffer& buffer : buffers) {
+        if (buffer.length > 0) {
+            writeBytes(buffer.data, (size_t)buffer.length);
+        }
+        writePadding();
+    }
+    if (_position - bodyStart != (uint64_t)bodyLength) {
+        _failed = true;
+    }
+    return !_failed;
+}
+
+/**
+ * @brief Write the dictionary of every dictionary column as a batch of one string column
+ *
+ * @return bool whether they were written
+ */
+bool ArrowWriter::writeDictionaries() {
+    for (size_t i = 0; i < _fields.size(); i++) {
+        const vector<string>& dictionary = _fields[i].dictionary;
+        if (dictionary.empty()) {
+            continue;
+        }
+        vector<int32_t> offsets(1, 0);
+        string characters;
+        for (const string& value : dictionary) {
+            characters += value;
+            offsets.push_back((int32_t)characters.size());
+        }
+
+        int64_t rows = (int64_t)dictionary.size();
+        int64_t offsetsLength = (int64_t)(offsets.size() * sizeof(int32_t));
+        int64_t charactersLength = (int64_t)characters.size();
+        vector<Buffer> buffers = {{nullptr, 0, 0}, {offsets.data(), 0, offsetsLength}, {characters.data(), (int64_t)padded((size_t)offsetsLength), charactersLength}};
+        int64_t bodyLength = buffers[2].offset + (int64_t)padded((size_t)charactersLength);
+
+        FlatBuilder builder;
+        uint32_t data = buildRecordBatch(builder, rows, {rows, 0}, {0, 0, 0, offsetsLength, buffers[2].offset, charactersLength});
+        builder.startTable();
+        builder.addScalar<int64_t>(0, (int64_t)i);
+        builder.addOffset(1, data);
+        builder.addScalar<uint8_t>(2, 0);
+        uint32_t dictionaryBatch = builder.endTable();
+
+        Block block;
+        if (!writeMessage(buildMessage(builder, HEADER_DICTIONARY_BATCH, dictionaryBatch, bodyLength), buffers, bodyLength, block)) {
+            return false;
+        }
+        _dictionaryBlocks.push_back(block);
+    }
+    return true;
+}
+
+/**
+ * @brief Write bytes and count them
+ *
+ * @return bool whether they were written
+ */
+bool ArrowWriter::writeBytes(const void* data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, _file) != size) {
+        _failed = true;
+    }
+    _position += size;
+    return !_failed;
+}
+
+/**
+ * @brief Write zeros up to the next multiple of 8 bytes in the file
+ *
+ * @return bool whether they were written
+ */
+bool ArrowWriter::writePadding() {
+    const uint8_t zeros[ALIGNMENT] = {};
+    return writeBytes(zeros, padded((size_t)_position) - (size_t)_position);
+}
@@ -0,0 +1,170 @@
+#ifndef ARROWWRITER_H
+#define ARROWWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes a table as an Arrow IPC file (readable as Feather v2 by pyarrow, pandas, polars or R)
+ * one record batch at a time, so results can be written while they are still being computed
+ *
+ * Columns are written straight from the caller's buffers without being copied or converted, so a
+ * reader can memory map the file and use them in place. Values are never null.
+ */
+class ArrowWriter {
+    public:
+        enum class Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64, Float32, Float64, Utf8 };
+
+        /**
+         * @brief One column of the table
+         *
+         * A list column holds a variable number of values of its type per row. A dictionary column
+         * holds integer indexes of its type into the dictionary strings, which are written once.
+         */
+        struct Field {
+            std::string name;
+            Type type;
+            bool list;
+            std::vector<std::string> dictionary;
+
+            /**
+             * @brief Construct a column of values, or of lists of values
+             *
+             */
+            Field(const std::string&, Type, bool = false);
+
+            /**
+             * @brief Construct a column of indexes into the given strings
+             *
+             */
+            Field(const std::string&, Type, const std::vector<std::string>&);
+        };
+
+        /**
+         * @brief The buffers of one column in a batch: the values, and for strings and lists
+         * rows + 1 offsets starting at 0 where each row's values begin
+         *
+         */
+        struct Column {
+            const void* values = nullptr;
+            const int32_t* offsets = nullptr;
+        };
+
+        /**
+         * @brief Construct a closed ArrowWriter
+         *
+         */
+        ArrowWriter();
+
+        /**
+         * @brief Close the file if it is still open
+         *
+         */
+        ~ArrowWriter();
+
+        ArrowWriter(const ArrowWriter&) = delete;
+        ArrowWriter& operator=(const ArrowWriter&) = delete;
+
+        /**
+         * @brief Create the file and write the schema and dictionaries of the given columns
+         *
+         * @return bool whether the file could be created
+         */
+        bool open(const std::string&, const std::vector<Field>&);
+
+        /**
+         * @brief Check whether a file is open
+         *
+         * @return bool
+         */
+        bool isOpen() const;
+
+        /**
+         * @brief Append a record batch of the given number of rows, one Column per field
+         *
+         * @return bool whether the batch was written
+         */
+        bool writeBatch(size_t, const std::vector<Column>&);
+
+        /**
+         * @brief Get the number of rows written so far
+         *
+         * @return uint64_t
+         */
+        uint64_t getRowCount() const;
+
+        /**
+         * @brief Write the footer that makes the file readable and close it
+         *
+         * @return bool whether everything was written
+         */
+        bool close();
+
+        /**
+         * @brief Get the size in bytes of one value of a type (0 for strings)
+         *
+         * @return size_t
+         */
+        static size_t getWidth(Type);
+
+    private:
+        // where a message is in the file, listed in the footer
+        struct Block {
+            int64_t offset;
+            int32_t metadataLength;
+            int64_t bodyLength;
+        };
+
+        // the location of a buffer in a message body
+        struct Buffer {
+            const void* data;
+            int64_t offset;
+            int64_t length;
+        };
+
+        // the length of an array in a message body, including nested ones
+        struct Node {
+            int64_t length;
+        };
+
+        /**
+         * @brief Write one message (metadata followed by its body) and give its location in the file
+         *
+         * @return bool whether it was written
+         */
+        bool writeMessage(const std::vector<uint8_t>&, const std::vector<Buffer>&, int64_t, Block&);
+
+        /**
+         * @brief Write the dictionary of every dictionary column as a batch of one string column
+         *
+         * @return bool whether they were written
+         */
+        bool writeDictionaries();
+
+        /**
+         * @brief Write bytes and count them
+         *
+         * @return bool whether they were written
+         */
+        bool writeBytes(const void*, size_t);
+
+        /**
+         * @brief Write zeros up to the next multiple of 8 bytes in the file
+         *
+         * @return bool whether they were written
+         */
+        bool writePadding();
+
+        FILE* _file;
+        uint64_t _position;
+        bool _failed;
+        std::vector<Field> _fields;
+        std::vector<Block> _dictionaryBlocks;
+        std::vector<Block> _batchBlocks;
+        uint64_t _rowCount;
+};
+
+#endif
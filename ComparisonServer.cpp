@@ -0,0 +1,652 @@
+#include "ComparisonServer.h"
+#include "StrandStore.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "ComparisonServer answers on a Unix domain socket, which this platform does not have"
+#endif
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    const char* OPERATION_NAMES[] = {"list species", "compare", "clusters", "search", "statistics", "metrics"};
+
+    #ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+    #else
+    const int SEND_FLAGS = 0;
+    #endif
+    // a client that takes none of its responses for this long is dropped
+    const int SEND_TIMEOUT_MILLISECONDS = 5000;
+    // no more requests are read from a client while this much of its output is waiting
+    const size_t OUTPUT_BACKLOG_BYTES = 4 << 20;
+
+    // append a number to a payload
+    template <class T>
+    void put(vector<uint8_t>& payload, T value) {
+        size_t offset = payload.size();
+        payload.resize(offset + sizeof(T));
+        memcpy(payload.data() + offset, &value, sizeof(T));
+    }
+
+    // read the next number of a payload, failing past its end
+    template <class T>
+    bool take(const vector<uint8_t>& payload, size_t& offset, T& value) {
+        if (payload.size() - offset < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, payload.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    // replace a payload with an error message
+    ComparisonServer::Status fail(vector<uint8_t>& response, ComparisonServer::Status status, const string& message) {
+        response.assign(message.begin(), message.end());
+        return status;
+    }
+}
+
+/**
+ * @brief Construct a server over loaded datasets and their statistics, which must outlive it
+ *
+ */
+ComparisonServer::ComparisonServer(const vector<const Dataset*>& datasets, const Statistics& statistics) : _statistics(statistics) {
+    _datasets = datasets;
+    for (size_t i = 0; i < _datasets.size(); i++) {
+        vector<const DNAStrand*> strands;
+        for (size_t j = 0; j < _datasets.at(i)->getAvailableCount(); j++) {
+            strands.push_back(&_datasets.at(i)->at(j));
+        }
+        _strands.push_back(strands);
+    }
+    _listener = -1;
+    _wakePipe[0] = -1;
+    _wakePipe[1] = -1;
+    _stopping = false;
+    _runningBatches = 0;
+    _batchCount = 0;
+    _batchedRequests = 0;
+}
+
+/**
+ * @brief Stop serving and remove the socket
+ *
+ */
+ComparisonServer::~ComparisonServer() {
+    if (_listener >= 0) {
+        close(_listener);
+        unlink(_path.c_str());
+    }
+    for (size_t i = 0; i < 2; i++) {
+        if (_wakePipe[i] >= 0) {
+            close(_wakePipe[i]);
+        }
+    }
+}
+
+/**
+ * @brief Close the socket once no batch holds the connection anymore
+ *
+ */
+ComparisonServer::Connection::~Connection() {
+    if (descriptor >= 0) {
+        close(descriptor);
+    }
+}
+
+/**
+ * @brief Create the socket at the given path, replacing a stale one left by a server that is gone
+ *
+ * @return bool whether the socket is listening
+ */
+bool ComparisonServer::listen(const string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // a socket file that still accepts connections belongs to a running server
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        return false;
+    }
+    bool inUse = connect(probe, (const sockaddr*)&address, sizeof(address)) == 0;
+    close(probe);
+    if (inUse) {
+        return false;
+    }
+    unlink(path.c_str());
+
+    _listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listener < 0) {
+        return false;
+    }
+    if (bind(_listener, (const sockaddr*)&address, sizeof(address)) != 0 || ::listen(_listener, 64) != 0 || pipe(_wakePipe) != 0) {
+        close(_listener);
+        _listener = -1;
+        return false;
+    }
+    fcntl(_listener, F_SETFL, fcntl(_listener, F_GETFL) | O_NONBLOCK);
+    fcntl(_wakePipe[0], F_SETFL, fcntl(_wakePipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(_wakePipe[1], F_SETFL, fcntl(_wakePipe[1], F_GETFL) | O_NONBLOCK);
+    _path = path;
+    return true;
+}
+
+/**
+ * @brief Serve connections on the calling thread until stop is called
+ *
+ */
+void ComparisonServer::run() {
+    if (_listener < 0) {
+        return;
+    }
+    while (true) {
+        // once stopping, nothing new is read, but what was already received is still answered and sent
+        bool stopping = _stopping;
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        int timeout = -1;
+        bool waiting = false;
+        vector<pollfd> descriptors(2 + _connections.size());
+        descriptors[0] = {_wakePipe[0], POLLIN, 0};
+        descriptors[1] = {_listener, (short)(stopping ? 0 : POLLIN), 0};
+        for (size_t i = 0; i < _connections.size(); i++) {
+            Connection& connection = *_connections.at(i);
+            short events = 0;
+            lock_guard<mutex> lock(connection.outputMutex);
+            if (!stopping && !connection.draining && connection.output.size() < OUTPUT_BACKLOG_BYTES) {
+                events |= POLLIN;
+            }
+            if (!connection.output.empty()) {
+                events |= POLLOUT;
+                waiting = true;
+                // wake up in time to drop a client that stopped reading
+                chrono::milliseconds left = chrono::duration_cast<chrono::milliseconds>(connection.lastProgress - now) + chrono::milliseconds(SEND_TIMEOUT_MILLISECONDS);
+                int milliseconds = (int)max(left.count() + 1, (chrono::milliseconds::rep)0);
+                timeout = timeout < 0 ? milliseconds : min(timeout, milliseconds);
+            }
+            descriptors[2 + i] = {connection.descriptor, events, 0};
+        }
+        if (stopping && !waiting) {
+            lock_guard<mutex> lock(_batchMutex);
+            if (_runningBatches == 0) {
+                break;
+            }
+        }
+        if (poll(descriptors.data(), (nfds_t)descriptors.size(), timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (descriptors[0].revents != 0) {
+            char drained[64];
+            while (read(_wakePipe[0], drained, sizeof(drained)) > 0) {
+            }
+        }
+
+        // every complete request that arrived on any connection this round goes into one batch, and every
+        // connection gets out what responses it can take
+        now = chrono::steady_clock::now();
+        vector<Request> batch;
+        vector<shared_ptr<Connection>> open;
+        for (size_t i = 0; i < _connections.size(); i++) {
+            const shared_ptr<Connection>& connection = _connections.at(i);
+            bool reading = (descriptors[2 + i].events & POLLIN) != 0;
+            short revents = descriptors[2 + i].revents;
+            // a client that hung up takes no responses either
+            bool keep = reading ? revents == 0 || readConnection(connection, batch) : (revents & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+            keep = keep && writeConnection(*connection, now);
+            if (keep && connection->draining) {
+                lock_guard<mutex> lock(connection->outputMutex);
+                keep = !connection->output.empty();
+            }
+            if (keep) {
+                open.push_back(connection);
+            } else {
+                connection->closed = true;
+            }
+        }
+        _connections = open;
+        if (descriptors[1].revents != 0) {
+            acceptConnections();
+        }
+
+        if (!batch.empty()) {
+            {
+                lock_guard<mutex> lock(_batchMutex);
+                _runningBatches++;
+            }
+            shared_ptr<vector<Request>> requests = make_shared<vector<Request>>(move(batch));
+            TaskScheduler::shared().submit([this, requests]() {
+                runBatch(*requests);
+                {
+                    lock_guard<mutex> lock(_batchMutex);
+                    _runningBatches--;
+                }
+                wake();
+            }, TaskScheduler::Priority::Interactive);
+        }
+    }
+    _connections.clear();
+}
+
+/**
+ * @brief Make run return once the requests in flight are answered; safe to call from a signal handler
+ *
+ */
+void ComparisonServer::stop() {
+    _stopping = true;
+    wake();
+}
+
+/**
+ * @brief Get a readable summary of the requests served and their latencies
+ *
+ * @return std::string
+ */
+string ComparisonServer::describeMetrics() const {
+    lock_guard<mutex> lock(_metricsMutex);
+    ostringstream description;
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        const Latency& latency = _latencies[i];
+        if (latency.count == 0) {
+            continue;
+        }
+        description << OPERATION_NAMES[i] << ": " << latency.count << " requests, mean " << (double)latency.totalNanoseconds / (double)latency.count / 1000
+                    << " us, p50 " << latency.findPercentile(0.5) << " us, p99 " << latency.findPercentile(0.99) << " us, max "
+                    << (double)latency.maxNanoseconds / 1000 << " us" << endl;
+    }
+    description << _batchedRequests << " requests in " << _batchCount << " batches" << endl;
+    return description.str();
+}
+
+/**
+ * @brief Estimate the latency below which the given fraction of requests finished
+ *
+ * @return double microseconds
+ */
+double ComparisonServer::Latency::findPercentile(double fraction) const {
+    uint64_t target = (uint64_t)(fraction * (double)count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            if (i < 8) {
+                return (double)i / 1000;
+            }
+            // middle of the bucket, but never past the slowest request
+            size_t shift = i / 4 - 2;
+            double low = (double)((4 + i % 4) << shift);
+            return min(low + (double)((uint64_t)1 << shift) / 2, (double)maxNanoseconds) / 1000;
+        }
+    }
+    return (double)maxNanoseconds / 1000;
+}
+
+/**
+ * @brief Accept every pending connection
+ *
+ */
+void ComparisonServer::acceptConnections() {
+    while (true) {
+        int descriptor = accept(_listener, nullptr, nullptr);
+        if (descriptor < 0) {
+            return;
+        }
+        fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+        #ifdef SO_NOSIGPIPE
+        int enabled = 1;
+        setsockopt(descriptor, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+        #endif
+        shared_ptr<Connection> connection = make_shared<Connection>();
+        connection->descriptor = descriptor;
+        _connections.push_back(connection);
+    }
+}
+
+/**
+ * @brief Read what a connection has sent and split off its complete requests
+ *
+ * @return bool whether the connection is still open
+ */
+bool ComparisonServer::readConnection(const shared_ptr<Connection>& connection, vector<Request>& requests) {
+    bool open = true;
+    uint8_t buffer[65536];
+    while (true) {
+        ssize_t received = recv(connection->descriptor, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection->input.insert(connection->input.end(), buffer, buffer + received);
+        } else {
+            open = received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+            break;
+        }
+    }
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    size_t offset = 0;
+    while (connection->input.size() - offset >= sizeof(Header)) {
+        Request request;
+        memcpy(&request.header, connection->input.data() + offset, sizeof(Header));
+        if (request.header.payloadSize > MAX_PAYLOAD) {
+            // the stream can't be trusted past a bad header
+            string message = "payload too large";
+            Header header = request.header;
+            header.payloadSize = (uint32_t)message.size();
+            header.status = BadRequest;
+            lock_guard<mutex> lock(connection->outputMutex);
+            if (connection->output.empty()) {
+                connection->lastProgress = now;
+            }
+            const uint8_t* bytes = (const uint8_t*)&header;
+            connection->output.insert(connection->output.end(), bytes, bytes + sizeof(Header));
+            connection->output.insert(connection->output.end(), message.begin(), message.end());
+            connection->draining = true;
+            connection->input.clear();
+            return open;
+        }
+        if (connection->input.size() - offset - sizeof(Header) < request.header.payloadSize) {
+            break;
+        }
+        const uint8_t* payload = connection->input.data() + offset + sizeof(Header);
+        request.payload.assign(payload, payload + request.header.payloadSize);
+        request.connection = connection;
+        request.received = now;
+        requests.push_back(move(request));
+        offset += sizeof(Header) + requests.back().header.payloadSize;
+    }
+    connection->input.erase(connection->input.begin(), connection->input.begin() + (ptrdiff_t)offset);
+    return open;
+}
+
+/**
+ * @brief Answer a batch of requests on the shared scheduler, then queue each connection its responses
+ * for the poll thread to send
+ *
+ */
+void ComparisonServer::runBatch(vector<Request>& requests) {
+    vector<vector<uint8_t>> responses(requests.size());
+    TaskScheduler::shared().parallelFor(requests.size(), 4, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            vector<uint8_t> payload;
+            Header header = requests[i].header;
+            header.status = handle(requests[i], payload);
+            header.payloadSize = (uint32_t)payload.size();
+            responses[i].resize(sizeof(Header));
+            memcpy(responses[i].data(), &header, sizeof(Header));
+            responses[i].insert(responses[i].end(), payload.begin(), payload.end());
+            recordLatency(requests[i].header.operation, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - requests[i].received).count());
+        }
+    }, TaskScheduler::Priority::Interactive);
+
+    // a worker never waits on a client; the poll thread sends once the socket takes more
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    for (size_t i = 0; i < requests.size(); i++) {
+        Connection& connection = *requests[i].connection;
+        lock_guard<mutex> lock(connection.outputMutex);
+        if (connection.closed) {
+            continue;
+        }
+        if (connection.output.empty()) {
+            connection.lastProgress = now;
+        }
+        connection.output.insert(connection.output.end(), responses[i].begin(), responses[i].end());
+    }
+
+    lock_guard<mutex> lock(_metricsMutex);
+    _batchCount++;
+    _batchedRequests += requests.size();
+}
+
+/**
+ * @brief Answer one request, writing its response payload
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::handle(const Request& request, vector<uint8_t>& response) {
+    switch (request.header.operation) {
+        case ListSpecies:
+            return listSpecies(response);
+        case Compare:
+            return compare(request.payload, response);
+        case Clusters:
+            return findClusters(request.payload, response);
+        case Search:
+            return search(request.payload, response);
+        case Stats:
+            return findStatistics(request.payload, response);
+        case Metrics:
+            return findMetrics(response);
+        default:
+            return fail(response, UnknownOperation, "unknown operation " + to_string(request.header.operation));
+    }
+}
+
+/**
+ * @brief Answer ListSpecies
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::listSpecies(vector<uint8_t>& response) const {
+    put(response, (uint32_t)_datasets.size());
+    for (size_t i = 0; i < _datasets.size(); i++) {
+        string name = _datasets.at(i)->getName();
+        put(response, (uint32_t)_strands.at(i).size());
+        put(response, (uint16_t)name.size());
+        response.insert(response.end(), name.begin(), name.end());
+    }
+    return Ok;
+}
+
+/**
+ * @brief Answer Compare from the memoized comparisons of the strand store
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::compare(const vector<uint8_t>& request, vector<uint8_t>& response) const {
+    size_t offset = 0;
+    uint16_t first;
+    uint16_t second;
+    uint32_t strand;
+    if (!take(request, offset, first) || !take(request, offset, second) || !take(request, offset, strand)) {
+        return fail(response, BadRequest, "compare needs two species and a strand");
+    }
+    if (first >= _datasets.size() || second >= _datasets.size() || strand >= _strands.at(first).size() || strand >= _strands.at(second).size()) {
+        return fail(response, NotFound, "no such species or strand");
+    }
+    shared_ptr<const DNAStrand> firstStrand = _datasets.at(first)->getStrand(strand);
+    shared_ptr<const DNAStrand> secondStrand = _datasets.at(second)->getStrand(strand);
+    put(response, StrandStore::shared().compareDNA(firstStrand, secondStrand));
+    put(response, StrandStore::shared().compareProteins(firstStrand, secondStrand));
+    put(response, (int32_t)StrandStore::shared().editDistance(firstStrand, secondStrand));
+    return Ok;
+}
+
+/**
+ * @brief Answer Clusters from the memoized clusters of the strand store
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::findClusters(const vector<uint8_t>& request, vector<uint8_t>& response) const {
+    size_t offset = 0;
+    uint16_t first;
+    uint16_t second;
+    uint32_t strand;
+    uint8_t proteins;
+    if (!take(request, offset, first) || !take(request, offset, second) || !take(request, offset, strand) || !take(request, offset, proteins)) {
+        return fail(response, BadRequest, "clusters needs two species, a strand and whether to use proteins");
+    }
+    if (first >= _datasets.size() || second >= _datasets.size() || strand >= _strands.at(first).size() || strand >= _strands.at(second).size()) {
+        return fail(response, NotFound, "no such species or strand");
+    }
+    shared_ptr<const DNAStrand> firstStrand = _datasets.at(first)->getStrand(strand);
+    shared_ptr<const DNAStrand> secondStrand = _datasets.at(second)->getStrand(strand);
+    vector<int> clusters = proteins != 0 ? StrandStore::shared().findProteinClusters(firstStrand, secondStrand)
+                                         : StrandStore::shared().findClusters(firstStrand, secondStrand);
+    put(response, (uint32_t)clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++) {
+        put(response, (int32_t)clusters.at(i));
+    }
+    return Ok;
+}
+
+/**
+ * @brief Answer Search with a banded edit distance from the query to every strand of the species
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::search(const vector<uint8_t>& request, vector<uint8_t>& response) const {
+    size_t offset = 0;
+    uint16_t species;
+    int32_t maxDistance;
+    uint32_t limit;
+    if (!take(request, offset, species) || !take(request, offset, maxDistance) || !take(request, offset, limit) || offset == request.size()) {
+        return fail(response, BadRequest, "search needs a species, a distance, a limit and a sequence");
+    }
+    if (species >= _datasets.size()) {
+        return fail(response, NotFound, "no such species");
+    }
+    DNAStrand query("query", string(request.begin() + (ptrdiff_t)offset, request.end()), 0);
+    vector<int> distances = query.editDistances(_strands.at(species), maxDistance);
+
+    vector<pair<int, uint32_t>> matches;
+    for (size_t i = 0; i < distances.size(); i++) {
+        if (maxDistance < 0 || distances.at(i) <= maxDistance) {
+            matches.push_back(make_pair(distances.at(i), (uint32_t)i));
+        }
+    }
+    size_t count = min(matches.size(), (size_t)limit);
+    partial_sort(matches.begin(), matches.begin() + (ptrdiff_t)count, matches.end());
+    put(response, (uint32_t)count);
+    for (size_t i = 0; i < count; i++) {
+        put(response, matches.at(i).second);
+        put(response, (int32_t)matches.at(i).first);
+    }
+    return Ok;
+}
+
+/**
+ * @brief Answer Statistics from the counts computed at startup
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::findStatistics(const vector<uint8_t>& request, vector<uint8_t>& response) const {
+    size_t offset = 0;
+    uint16_t species;
+    if (!take(request, offset, species)) {
+        return fail(response, BadRequest, "statistics needs a species");
+    }
+    if (species >= _statistics.getSpeciesCount()) {
+        return fail(response, NotFound, "no such species");
+    }
+    const Statistics::Counts& counts = _statistics.getSpecies(species);
+    put(response, counts.strandCount);
+    for (int i = 0; i < Statistics::BASE_COUNT; i++) {
+        put(response, counts.bases[i]);
+    }
+    for (int i = 0; i < Statistics::CODON_COUNT; i++) {
+        put(response, counts.codons[i]);
+    }
+    put(response, counts.getGCContent());
+    return Ok;
+}
+
+/**
+ * @brief Answer Metrics
+ *
+ * @return Status
+ */
+ComparisonServer::Status ComparisonServer::findMetrics(vector<uint8_t>& response) const {
+    lock_guard<mutex> lock(_metricsMutex);
+    put(response, (uint32_t)OPERATION_COUNT);
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        const Latency& latency = _latencies[i];
+        put(response, latency.count);
+        put(response, latency.count == 0 ? 0.0 : (double)latency.totalNanoseconds / (double)latency.count / 1000);
+        put(response, latency.findPercentile(0.5));
+        put(response, latency.findPercentile(0.99));
+        put(response, (double)latency.maxNanoseconds / 1000);
+    }
+    put(response, _batchCount);
+    put(response, _batchedRequests);
+    return Ok;
+}
+
+/**
+ * @brief Add the latency of an answered request to the metrics of its operation
+ *
+ */
+void ComparisonServer::recordLatency(uint16_t operation, uint64_t nanoseconds) {
+    if (operation < ListSpecies || operation >= ListSpecies + OPERATION_COUNT) {
+        return;
+    }
+    size_t bucket = (size_t)nanoseconds;
+    if (nanoseconds >= 8) {
+        size_t highest = 63;
+        while ((nanoseconds >> highest) == 0) {
+            highest--;
+        }
+        bucket = highest * 4 + (size_t)((nanoseconds >> (highest - 2)) & 3);
+    }
+
+    lock_guard<mutex> lock(_metricsMutex);
+    Latency& latency = _latencies[operation - ListSpecies];
+    latency.count++;
+    latency.totalNanoseconds += nanoseconds;
+    latency.maxNanoseconds = max(latency.maxNanoseconds, nanoseconds);
+    latency.buckets[bucket]++;
+}
+
+/**
+ * @brief Send as much of a connection's waiting output as its socket takes without blocking
+ *
+ * @return bool whether the connection is still open (false once it stopped reading for too long)
+ */
+bool ComparisonServer::writeConnection(Connection& connection, chrono::steady_clock::time_point now) {
+    lock_guard<mutex> lock(connection.outputMutex);
+    size_t sent = 0;
+    bool open = true;
+    while (sent < connection.output.size()) {
+        ssize_t written = send(connection.descriptor, connection.output.data() + sent, connection.output.size() - sent, SEND_FLAGS);
+        if (written > 0) {
+            sent += (size_t)written;
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else {
+            open = written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            break;
+        }
+    }
+    if (sent > 0) {
+        connection.output.erase(connection.output.begin(), connection.output.begin() + (ptrdiff_t)sent);
+        connection.lastProgress = now;
+    }
+    return open && (connection.output.empty() || now - connection.lastProgress < chrono::milliseconds(SEND_TIMEOUT_MILLISECONDS));
+}
+
+/**
+ * @brief Wake the poll thread; safe to call from a signal handler
+ *
+ */
+void ComparisonServer::wake() {
+    if (_wakePipe[1] >= 0) {
+        char wake = 0;
+        ssize_t written = write(_wakePipe[1], &wake, 1);
+        (void)written;
+    }
+}
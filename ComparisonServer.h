@@ -0,0 +1,245 @@
+#ifndef COMPARISONSERVER_H
+#define COMPARISONSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Dataset.h"
+#include "DNAStrand.h"
+#include "Statistics.h"
+
+/**
+ * @brief Long-running local service that keeps the loaded datasets, statistics and comparison memos
+ * hot and answers queries over a Unix domain socket (POSIX only)
+ *
+ * Every message is a Header followed by payloadSize bytes, numbers in host byte order. A client may
+ * send any number of requests without waiting; responses carry the request id and can come back in
+ * any order. Species are numbered in the order they were loaded, strands by their index in the dataset.
+ *
+ *   ListSpecies  request: -
+ *                response: uint32 count, then per species uint32 strands, uint16 name length, name
+ *   Compare      request: uint16 first species, uint16 second species, uint32 strand
+ *                response: double nucleotide %, double protein %, int32 edit distance
+ *   Clusters     request: uint16 first species, uint16 second species, uint32 strand, uint8 proteins
+ *                response: uint32 count, int32 cluster positions
+ *   Search       request: uint16 species, int32 max distance (-1 for any), uint32 limit, sequence
+ *                response: uint32 count, then per match uint32 strand, int32 edit distance, closest first
+ *   Statistics   request: uint16 species
+ *                response: uint64 strands, uint64 bases (A, C, G, T, other), uint64 codons (64), double GC %
+ *   Metrics      request: -
+ *                response: uint32 operations, then per operation uint64 requests and double mean,
+ *                p50, p99 and max latency in microseconds; then uint64 batches, uint64 batched requests
+ *
+ * A failed request gets a non-zero status and a message as its payload.
+ */
+class ComparisonServer {
+    public:
+        struct Header {
+            uint32_t payloadSize;
+            uint32_t requestId;
+            uint16_t operation;
+            uint16_t status;
+        };
+
+        enum Operation : uint16_t { ListSpecies = 1, Compare, Clusters, Search, Stats, Metrics };
+
+        enum Status : uint16_t { Ok = 0, BadRequest, UnknownOperation, NotFound };
+
+        static const uint32_t MAX_PAYLOAD = 1 << 24;
+
+        /**
+         * @brief Construct a server over loaded datasets and their statistics, which must outlive it
+         *
+         */
+        ComparisonServer(const std::vector<const Dataset*>&, const Statistics&);
+
+        /**
+         * @brief Stop serving and remove the socket
+         *
+         */
+        ~ComparisonServer();
+
+        ComparisonServer(const ComparisonServer&) = delete;
+        ComparisonServer& operator=(const ComparisonServer&) = delete;
+
+        /**
+         * @brief Create the socket at the given path, replacing a stale one left by a server that is gone
+         *
+         * @return bool whether the socket is listening
+         */
+        bool listen(const std::string&);
+
+        /**
+         * @brief Serve connections on the calling thread until stop is called
+         *
+         */
+        void run();
+
+        /**
+         * @brief Make run return once the requests in flight are answered; safe to call from a signal handler
+         *
+         */
+        void stop();
+
+        /**
+         * @brief Get a readable summary of the requests served and their latencies
+         *
+         * @return std::string
+         */
+        std::string describeMetrics() const;
+
+    private:
+        static const size_t OPERATION_COUNT = 6;
+        // latencies in nanoseconds, four linear steps per power of two
+        static const size_t LATENCY_BUCKETS = 64 * 4;
+
+        struct Connection {
+            int descriptor = -1;
+            std::vector<uint8_t> input;
+            // responses waiting for the socket to take them; batches add to it, only the poll thread sends
+            std::mutex outputMutex;
+            std::vector<uint8_t> output;
+            // when output last went out, or last became waiting
+            std::chrono::steady_clock::time_point lastProgress;
+            // after a bad header nothing more is read, and the connection goes once its output is sent
+            bool draining = false;
+            std::atomic<bool> closed{false};
+
+            ~Connection();
+        };
+
+        struct Request {
+            std::shared_ptr<Connection> connection;
+            Header header;
+            std::vector<uint8_t> payload;
+            std::chrono::steady_clock::time_point received;
+        };
+
+        struct Latency {
+            uint64_t count = 0;
+            uint64_t totalNanoseconds = 0;
+            uint64_t maxNanoseconds = 0;
+            uint64_t buckets[LATENCY_BUCKETS] = {};
+
+            /**
+             * @brief Estimate the latency below which the given fraction of requests finished
+             *
+             * @return double microseconds
+             */
+            double findPercentile(double) const;
+        };
+
+        /**
+         * @brief Accept every pending connection
+         *
+         */
+        void acceptConnections();
+
+        /**
+         * @brief Read what a connection has sent and split off its complete requests
+         *
+         * @return bool whether the connection is still open
+         */
+        bool readConnection(const std::shared_ptr<Connection>&, std::vector<Request>&);
+
+        /**
+         * @brief Send as much of a connection's waiting output as its socket takes without blocking
+         *
+         * @return bool whether the connection is still open (false once it stopped reading for too long)
+         */
+        bool writeConnection(Connection&, std::chrono::steady_clock::time_point);
+
+        /**
+         * @brief Answer a batch of requests on the shared scheduler, then queue each connection its responses
+         * for the poll thread to send
+         *
+         */
+        void runBatch(std::vector<Request>&);
+
+        /**
+         * @brief Answer one request, writing its response payload
+         *
+         * @return Status
+         */
+        Status handle(const Request&, std::vector<uint8_t>&);
+
+        /**
+         * @brief Answer ListSpecies
+         *
+         * @return Status
+         */
+        Status listSpecies(std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Answer Compare from the memoized comparisons of the strand store
+         *
+         * @return Status
+         */
+        Status compare(const std::vector<uint8_t>&, std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Answer Clusters from the memoized clusters of the strand store
+         *
+         * @return Status
+         */
+        Status findClusters(const std::vector<uint8_t>&, std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Answer Search with a banded edit distance from the query to every strand of the species
+         *
+         * @return Status
+         */
+        Status search(const std::vector<uint8_t>&, std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Answer Statistics from the counts computed at startup
+         *
+         * @return Status
+         */
+        Status findStatistics(const std::vector<uint8_t>&, std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Answer Metrics
+         *
+         * @return Status
+         */
+        Status findMetrics(std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Add the latency of an answered request to the metrics of its operation
+         *
+         */
+        void recordLatency(uint16_t, uint64_t);
+
+        /**
+         * @brief Wake the poll thread; safe to call from a signal handler
+         *
+         */
+        void wake();
+
+        std::vector<const Dataset*> _datasets;
+        // every strand of every species, kept for searches
+        std::vector<std::vector<const DNAStrand*>> _strands;
+        const Statistics& _statistics;
+
+        std::string _path;
+        int _listener;
+        int _wakePipe[2];
+        std::atomic<bool> _stopping;
+        std::vector<std::shared_ptr<Connection>> _connections;
+
+        std::mutex _batchMutex;
+        size_t _runningBatches;
+
+        mutable std::mutex _metricsMutex;
+        Latency _latencies[OPERATION_COUNT];
+        uint64_t _batchCount;
+        uint64_t _batchedRequests;
+};
+
+#endif
@@ -1,6 +1,16 @@
 #include "DNAStrand.h"
 #include "dna_functions.h"
+#include "sequence_kernels.h"
+#include "analysis_kernels.h"
+#include "EditDistance.h"
+#include "MemoryAccounting.h"
+#include "StrandArena.h"
+#include "TaskScheduler.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <SFML/Graphics.hpp>
@@ -9,28 +19,43 @@
 using namespace std;
 
 DNAStrand::DNAStrand() {
-    _sourceSpecies = "Unknown";
+    _arena = nullptr;
     _class = 0;
-    _sequence = "";
-    _pairSequence = "";
-    _codonSequence = {};
-    _proteinSequence = {};
+    _length = 0;
+    _sequence = nullptr;
+    _pairSequence = nullptr;
+    _codonCount = 0;
+    _codons = nullptr;
+    _aminoAcids = nullptr;
 }
 
-DNAStrand::DNAStrand(string speciesName, string dnaSequence, int classNum) {
+DNAStrand::DNAStrand(string speciesName, string dnaSequence, int classNum) : DNAStrand() {
     if (speciesName == "") {
-        _sourceSpecies = "Unknown";
+        speciesName = "Unknown";
     }
+    useOwnArena(speciesName);
+    _class = classNum;
+    allocateData(dnaSequence.length());
+    memcpy(_sequence, dnaSequence.data(), _length);
+    setupData();
+}
 
-    _sequence = dnaSequence;
+DNAStrand::DNAStrand(StrandArena& arena, const string& dnaSequence, int classNum) : DNAStrand() {
+    _arena = &arena;
     _class = classNum;
+    allocateData(dnaSequence.length());
+    memcpy(_sequence, dnaSequence.data(), _length);
     setupData();
 }
 
-DNAStrand::DNAStrand(const DNAStrand& copy) {
+DNAStrand::DNAStrand(const DNAStrand& copy) : DNAStrand() {
     deepCopy(copy);
 }
 
+DNAStrand::DNAStrand(DNAStrand&& other) noexcept : DNAStrand() {
+    *this = move(other);
+}
+
 DNAStrand& DNAStrand::operator=(const DNAStrand& other) {
     if (&other == this) {
         return *this;
@@ -42,28 +67,50 @@ DNAStrand& DNAStrand::operator=(const DNAStrand& other) {
     return *this;
 }
 
+DNAStrand& DNAStrand::operator=(DNAStrand&& other) noexcept {
+    if (&other == this) {
+        return *this;
+    }
+
+    _arena = other._arena;
+    _ownArena = move(other._ownArena);
+    _class = other._class;
+    _length = other._length;
+    _sequence = other._sequence;
+    _pairSequence = other._pairSequence;
+    _codonCount = other._codonCount;
+    _codons = other._codons;
+    _aminoAcids = other._aminoAcids;
+    other.deallocate();
+
+    return *this;
+}
+
 DNAStrand::~DNAStrand() {
     deallocate();
 }
 
 void DNAStrand::deallocate() {
-    for (size_t i = 0; i < _proteinSequence.size(); i++) {
-        delete _proteinSequence.at(i);
-    }
-    _proteinSequence.clear();
+    _ownArena.reset();
+    _arena = nullptr;
+    _length = 0;
+    _sequence = nullptr;
+    _pairSequence = nullptr;
+    _codonCount = 0;
+    _codons = nullptr;
+    _aminoAcids = nullptr;
 }
 
 void DNAStrand::deepCopy(const DNAStrand& copy) {
-    _sourceSpecies = copy._sourceSpecies;
-    _sequence = copy._sequence;
+    // the arena is only named for memory reports, after the arena the data came from
+    useOwnArena(copy._arena == nullptr ? "Unknown" : copy._arena->getName());
     _class = copy._class;
-    _pairSequence = copy._pairSequence;
-    _codonSequence = copy._codonSequence;
-    _proteinSequence.clear();
-
-    for (size_t i = 0; i < copy.getProteinSequence().size(); i++) {
-        _proteinSequence.push_back(new Protein(copy.getProteinSequence().at(i)->getSourceSpecies(), copy.getProteinSequence().at(i)->getCodon()));
-    }
+    allocateData(copy._length);
+    // copied rather than rebuilt, so codons changed with modifyCodon stay changed
+    memcpy(_sequence, copy._sequence, _length);
+    memcpy(_pairSequence, copy._pairSequence, _length);
+    memcpy(_codons, copy._codons, _codonCount);
+    memcpy(_aminoAcids, copy._aminoAcids, _codonCount);
 }
 
 void DNAStrand::setupData() {
@@ -72,72 +119,149 @@ void DNAStrand::setupData() {
     createProteinSequence();
 }
 
+/**
+ * @brief Give the strand a new arena of its own, named after the given species
+ * 
+ */
+void DNAStrand::useOwnArena(const string& speciesName) {
+    // every allocation gets a block of its exact size, since a single strand would waste most of a large one
+    _ownArena = make_shared<StrandArena>(speciesName, 0);
+    _arena = _ownArena.get();
+}
+
+/**
+ * @brief Take room in the arena for a sequence of the given length and its derived data
+ * 
+ */
+void DNAStrand::allocateData(size_t length) {
+    if (_arena == nullptr) {
+        useOwnArena("Unknown");
+    }
+    _length = length;
+    _codonCount = (length + CODON_LENGTH - 1) / CODON_LENGTH;
+    _sequence = (char*)_arena->allocate(MemoryTag::Sequences, _length, 1);
+    _pairSequence = (char*)_arena->allocate(MemoryTag::PairSequences, _length, 1);
+    _codons = (uint8_t*)_arena->allocate(MemoryTag::Codons, _codonCount, 1);
+    _aminoAcids = (uint8_t*)_arena->allocate(MemoryTag::Proteins, _codonCount, 1);
+}
+
 /**
  * @brief Maps the current _sequence to its associated nucleotide pair sequence
  * 
  */
 void DNAStrand::createPairSequence() {
-    _pairSequence.clear();
-    for (size_t i = 0; i < _sequence.length(); i++) {
-        _pairSequence.push_back(getPair(_sequence.at(i))); 
-    }
+    transcribeSequence(_sequence, _pairSequence, _length);
 }
 
 /**
- * @brief Maps the current _sequence to a vector of its associated codons
+ * @brief Maps the current _pairSequence to the codon table index of each of its codons
  * 
  */
 void DNAStrand::createCodonSequence() {
-    _codonSequence.clear();
-    for (size_t i = 0; i < _pairSequence.length(); i += 3) {
-        _codonSequence.push_back(_pairSequence.substr(i, 3));
-    }
+    findCodons<Alphabet::RNA>(_pairSequence, _length, _codons);
 }
 
 /**
- * @brief Maps the current _codonSequence to a vector of its associated proteins
+ * @brief Maps the current _codons to the amino acid number of each of their proteins
  * 
  */
 void DNAStrand::createProteinSequence() {
-    _proteinSequence.clear();
-    for (size_t i = 0; i < _codonSequence.size(); i++) {
-        _proteinSequence.push_back(new Protein(_sourceSpecies, _codonSequence.at(i)));
+    for (size_t i = 0; i < _codonCount; i++) {
+        _aminoAcids[i] = getAminoAcid(_codons[i]);
     }
 }
 
+/**
+ * @brief Rebuilds the codon and protein at the given codon index from the pair sequence
+ * 
+ */
+void DNAStrand::updateCodon(size_t codonIndex) {
+    if (codonIndex >= _codonCount) {
+        throw out_of_range("codon " + to_string(codonIndex) + " of a strand of " + to_string(_codonCount));
+    }
+    size_t start = codonIndex * CODON_LENGTH;
+    findCodons<Alphabet::RNA>(_pairSequence + start, min(CODON_LENGTH, _length - start), _codons + codonIndex);
+    _aminoAcids[codonIndex] = getAminoAcid(_codons[codonIndex]);
+}
+
 /**
  * @brief Get the Sequence object
  * 
- * @return std::string const DNA Sequence
+ * @return std::string_view DNA Sequence, valid while the strand is
  */
-string DNAStrand::getSequence() const {
-    return _sequence;
+string_view DNAStrand::getSequence() const {
+    return string_view(_sequence, _length);
 }
 
 /**
- * @brief Set the Sequence object
+ * @brief Set the Sequence object, rebuilding the pair sequence, codons and proteins
  * 
  */
 void DNAStrand::setSequence(string dnaSequence) {
-    _sequence = dnaSequence;
+    // a strand of its own moves to a new arena, which frees the old data
+    if (_ownArena != nullptr) {
+        useOwnArena(_ownArena->getName());
+    }
+    allocateData(dnaSequence.length());
+    memcpy(_sequence, dnaSequence.data(), _length);
+    setupData();
 }
 
 /**
  * @brief Get the Pair Sequence object
  * 
- * @return std::string pair sequence
+ * @return std::string_view pair sequence, valid while the strand is
+ */
+string_view DNAStrand::getPairSequence() const {
+    return string_view(_pairSequence, _length);
+}
+
+/**
+ * @brief Get the number of proteins (one per codon, a partial last codon included)
+ * 
+ * @return size_t
+ */
+size_t DNAStrand::getProteinCount() const {
+    return _codonCount;
+}
+
+/**
+ * @brief Get the amino acid number of every protein (see translateCodons)
+ * 
+ * @return const uint8_t* getProteinCount() amino acids
+ */
+const uint8_t* DNAStrand::getAminoAcids() const {
+    return _aminoAcids;
+}
+
+/**
+ * @brief Get the reverse complement of the DNA sequence
+ * 
+ * @return std::string reverse complement sequence
  */
-string DNAStrand::getPairSequence() const {
-    return _pairSequence;
+string DNAStrand::getReverseComplement() const {
+    string complement(_length, ' ');
+    reverseComplement(_sequence, complement.data(), _length);
+    return complement;
 }
 
 /**
- * @brief Get the Protein Sequence object
+ * @brief Get the Protein Sequence object, built from the codons and labelled with the given species
+ * (a strand interned by several datasets is shared by their species, so it has no single one)
  * 
  * @return vector<Protein> 
  */
-vector<Protein*> DNAStrand::getProteinSequence() const {
-    return _proteinSequence;
+vector<Protein> DNAStrand::getProteinSequence(const string& speciesName) const {
+    vector<Protein> proteins;
+    proteins.reserve(_codonCount);
+    for (size_t i = 0; i < _codonCount; i++) {
+        if (_codons[i] == UNKNOWN_CODON) {
+            proteins.push_back(Protein(speciesName, string(getPairSequence().substr(i * CODON_LENGTH, CODON_LENGTH))));
+        } else {
+            proteins.push_back(Protein(speciesName, Protein::getCodonName(_codons[i])));
+        }
+    }
+    return proteins;
 }
 
 /**
@@ -145,21 +269,14 @@ vector<Protein*> DNAStrand::getProteinSequence() const {
  * 
  */
 void DNAStrand::modifyNucleotide(int index, char nucleotide) {
-    _sequence.at(index) = nucleotide;
-    _pairSequence.at(index) = getPair(nucleotide);
-
-    // find codon
-    int codonIndex = index / 3;
-    int codonPosition = index % 3;
-
-    // edit codon
-    string modifiedCodon = _codonSequence.at(codonIndex);
-    modifiedCodon.at(codonPosition) = nucleotide;
-    _codonSequence.at(codonIndex) = modifiedCodon;
+    if ((size_t)index >= _length) {
+        throw out_of_range("base " + to_string(index) + " of a strand of " + to_string(_length));
+    }
+    _sequence[index] = nucleotide;
+    _pairSequence[index] = getPair(nucleotide);
 
-    // edit protein
-    delete _proteinSequence.at(codonIndex);
-    _proteinSequence.at(codonIndex) = new Protein(_sourceSpecies, modifiedCodon);
+    // codons are read from the pair sequence
+    updateCodon((size_t)index / CODON_LENGTH);
 }
 
 /**
@@ -168,34 +285,94 @@ void DNAStrand::modifyNucleotide(int index, char nucleotide) {
  */
 void DNAStrand::modifyCodon(int index, string codon) {
     for (int i = index; i < 3; i++) {
-        _sequence.at(i) = codon.at(i-index);
-        _pairSequence.at(i) = getPair(codon.at(i-index));
+        if ((size_t)i >= _length) {
+            throw out_of_range("base " + to_string(i) + " of a strand of " + to_string(_length));
+        }
+        _sequence[i] = codon.at(i-index);
+        _pairSequence[i] = getPair(codon.at(i-index));
     }
     
     // edit protein
-    delete _proteinSequence.at(index);
-    _proteinSequence.at(index) = new Protein(_sourceSpecies, codon);
+    if ((size_t)index >= _codonCount) {
+        throw out_of_range("codon " + to_string(index) + " of a strand of " + to_string(_codonCount));
+    }
+    int codonIndex = Protein::findCodonIndex(codon);
+    _codons[index] = codonIndex < 0 ? UNKNOWN_CODON : (uint8_t)codonIndex;
+    _aminoAcids[index] = getAminoAcid(codonIndex);
 }
 
 /**
- * @brief  Find the percentage of the two DNA strands that share similarity
+ * @brief Apply a batch of mutations sorted by position, rebuilding each changed codon once
+ * (or the derived data once if the length changes)
  * 
  */
-double DNAStrand::compareDNA(DNAStrand& other) const {
-    double matches = 0;
+void DNAStrand::applyMutations(const vector<Mutation>& mutations) {
+    bool substitutionsOnly = true;
+    for (size_t i = 0; i < mutations.size(); i++) {
+        substitutionsOnly = substitutionsOnly && mutations[i].kind == Mutation::Substitution;
+    }
 
-    // find strand end
-    size_t end = this->_sequence.size();
-    if (other._sequence.size() < end) {
-        end = other._sequence.size();
+    if (!substitutionsOnly) {
+        // an indel shifts every later codon, so rebuild everything in one pass
+        string mutated;
+        {
+            MemoryScope scope(MemoryTag::Sequences);
+            applyMutations(getSequence(), mutations, mutated);
+        }
+        setSequence(move(mutated));
+        return;
     }
 
-    // find number of matches in strand
-    for (size_t i = 0; i < end; i++) {
-        if (other.getSequence().at(i) == _sequence.at(i)) {
-            matches += 1;
+    for (size_t i = 0; i < mutations.size(); i++) {
+        if (mutations[i].position >= _length) {
+            throw out_of_range("base " + to_string(mutations[i].position) + " of a strand of " + to_string(_length));
+        }
+        _sequence[mutations[i].position] = mutations[i].nucleotide;
+        _pairSequence[mutations[i].position] = getPair(mutations[i].nucleotide);
+        size_t codonIndex = mutations[i].position / CODON_LENGTH;
+        if (i + 1 == mutations.size() || mutations[i + 1].position / CODON_LENGTH != codonIndex) {
+            updateCodon(codonIndex);
+        }
+    }
+}
+
+/**
+ * @brief Write a sequence with a batch of mutations sorted by position applied into out
+ * 
+ */
+void DNAStrand::applyMutations(string_view sequence, const vector<Mutation>& mutations, string& out) {
+    out.clear();
+    out.reserve(sequence.length() + mutations.size());
+    size_t copied = 0;
+    for (size_t i = 0; i < mutations.size(); i++) {
+        const Mutation& mutation = mutations[i];
+        out.append(sequence, copied, mutation.position - copied);
+        copied = mutation.position;
+        if (mutation.kind == Mutation::Insertion) {
+            out.push_back(mutation.nucleotide);
+        } else if (mutation.kind == Mutation::Substitution) {
+            out.push_back(mutation.nucleotide);
+            copied++;
+        } else {
+            copied++;
         }
     }
+    out.append(sequence, copied, string::npos);
+}
+
+/**
+ * @brief  Find the percentage of the two DNA strands that share similarity
+ * 
+ */
+double DNAStrand::compareDNA(const DNAStrand& other) const {
+    // find strand end
+    size_t end = this->_length;
+    if (other._length < end) {
+        end = other._length;
+    }
+
+    // find number of matches in strand
+    double matches = (double)countMatches<Alphabet::DNA, Encoding::Byte>((const uint8_t*)_sequence, (const uint8_t*)other._sequence, end);
 
     // calculate percentage similarity
     return matches/(int)end * 100;
@@ -206,54 +383,16 @@ double DNAStrand::compareDNA(DNAStrand& other) const {
  * 
  * @return std::vector<int> clusters
  */
-vector<int> DNAStrand::findClusters(DNAStrand& other) const {
+vector<int> DNAStrand::findClusters(const DNAStrand& other) const {
     // find end of strand
-    size_t end = _sequence.size();
-    if (other._sequence.size() < end) {
-        end = other._sequence.size();
+    size_t end = _length;
+    if (other._length < end) {
+        end = other._length;
     }
 
-    // create vector holding the similarity percentages for subsections of 5 nucleotides
-    vector<double> similarityVals;
-    for (size_t i = 0; i <= end - 5; i++) {
-        double matches = 0;
-        for (size_t j = 0; j < 5; j++) {
-            if (_sequence[i+j] == other.getSequence()[i+j]) {
-                matches += 1;
-            }
-        }
-        similarityVals.push_back(matches/5);
-    }
-
-    // check for top 5
-    vector<int> topClusters;
-    if (similarityVals.size() < 5) {
-        for (size_t i = 0; i < similarityVals.size(); i++) {
-            topClusters.push_back((int)i);
-        }
-    } else {
-        topClusters = {0, 5, 10, 15, 20};
-        size_t currMin = getMin(similarityVals, topClusters);
-        for (size_t i = 5; i < similarityVals.size(); i++) {
-            if (similarityVals.at(i) > similarityVals.at(topClusters.at(currMin))) {
-                // only add unique clusters
-                // TODO could override if near cluster has higher similarity
-                bool isUnique = true;
-                for (size_t j = 0; j < topClusters.size(); j++) {
-                    if (abs((int)i - (int)topClusters.at(j)) < 5) {
-                        isUnique = false;
-                        break;
-                    }
-                }
-                if (isUnique) {
-                    topClusters.at(currMin) = (int)i;
-                    currMin = getMin(similarityVals, topClusters);
-                }
-            }
-        }
-    }
-
-    return topClusters;
+    // every window of CLUSTER_WIDTH nucleotides, starting from windows a width apart
+    size_t windows = end >= CLUSTER_WIDTH ? end - CLUSTER_WIDTH + 1 : 0;
+    return findClusterWindows(Alphabet::DNA, Encoding::Byte, CLUSTER_WIDTH, windows, (const uint8_t*)_sequence, (const uint8_t*)other._sequence, CLUSTER_WIDTH);
 }
 
 /**
@@ -261,21 +400,15 @@ vector<int> DNAStrand::findClusters(DNAStrand& other) const {
  * 
  * @return double 
  */
-double DNAStrand::compareProteins(DNAStrand& other) const {
-    double matches = 0;
-
+double DNAStrand::compareProteins(const DNAStrand& other) const {
     // find end of strand
-    size_t end = this->_proteinSequence.size();
-    if (other.getProteinSequence().size() < end) {
-        end = other.getProteinSequence().size();
+    size_t end = this->_codonCount;
+    if (other._codonCount < end) {
+        end = other._codonCount;
     }
 
     // find number of matches
-    for (size_t i = 0; i < end; i++) {
-        if (other.getProteinSequence().at(i)->findProtein() == _proteinSequence.at(i)->findProtein() && _proteinSequence[i]->findProtein() != "?") {
-            matches += 1;
-        }
-    }
+    double matches = (double)countMatches<Alphabet::AminoAcid, Encoding::Byte>(_aminoAcids, other._aminoAcids, end);
 
     return matches/(int)end * 100;
 }
@@ -285,54 +418,44 @@ double DNAStrand::compareProteins(DNAStrand& other) const {
  * 
  * @return std::vector<int> clusters
  */
-vector<int> DNAStrand::findProteinClusters(DNAStrand& other) const {
+vector<int> DNAStrand::findProteinClusters(const DNAStrand& other) const {
     // find end of strand
-    size_t end = _proteinSequence.size();
-    if (other._proteinSequence.size() < end) {
-        end = other._proteinSequence.size();
+    size_t end = _codonCount;
+    if (other._codonCount < end) {
+        end = other._codonCount;
     }
 
-    // create vector of similarity percentages in clusters of 5 proteins.
-    vector<double> similarityVals;
-    for (size_t i = 0; i < end - 5; i++) {
-        double matches = 0;
-        for (size_t j = 0; j < 5; j++) {
-            if (_proteinSequence[i + j]->findProtein() == other._proteinSequence[i + j]->findProtein() && _proteinSequence[i + j]->findProtein() != "?") {
-                matches+=1;
-            }
-        }
-        similarityVals.push_back(matches/5);
-    }
+    // windows of CLUSTER_WIDTH proteins, starting from the first few; the last window has never been
+    // searched, and leaving it out keeps cached and exported clusters the same
+    size_t windows = end > CLUSTER_WIDTH ? end - CLUSTER_WIDTH : 0;
+    return findClusterWindows(Alphabet::AminoAcid, Encoding::Byte, CLUSTER_WIDTH, windows, _aminoAcids, other._aminoAcids, 1);
+}
 
-    // check for top 5
-    vector<int> topClusters;
-    if (similarityVals.size() < 5) {
-        for (size_t i = 0; i < similarityVals.size(); i++) {
-            topClusters.push_back((int)i);
-        }
-    } else {
-        topClusters = {0, 1, 2, 3, 4};
-        size_t currMin = getMin(similarityVals, topClusters);
-        for (size_t i = 5; i < similarityVals.size(); i++) {
-            if (similarityVals.at(i) > similarityVals.at(topClusters.at(currMin))) {
-                // only add unique clusters
-                // TODO could override if near cluster has higher similarity
-                bool isUnique = true;
-                for (size_t j = 0; j < topClusters.size(); j++) {
-                    if (abs((int)i - (int)topClusters.at(j)) < 5) {
-                        isUnique = false;
-                        break;
-                    }
-                }
-                if (isUnique) {
-                    topClusters.at(currMin) = (int)i;
-                    currMin = getMin(similarityVals, topClusters);
-                }
-            }
-        }
-    }
+/**
+ * @brief Find the number of nucleotide insertions, deletions and substitutions between the
+ * two DNA strands; with maxDistance >= 0 the search stops at maxDistance + 1
+ * 
+ * @return int edit distance
+ */
+int DNAStrand::editDistance(const DNAStrand& other, int maxDistance) const {
+    return EditDistance::between(getSequence(), other.getSequence(), maxDistance);
+}
 
-    return topClusters;
+/**
+ * @brief Find the edit distance to each of the given DNA strands in parallel, reusing the
+ * bit masks of this strand for every comparison
+ * 
+ * @return std::vector<int> edit distances in the order of the given strands
+ */
+vector<int> DNAStrand::editDistances(const vector<const DNAStrand*>& others, int maxDistance) const {
+    EditDistance pattern(getSequence());
+    vector<int> distances(others.size());
+    TaskScheduler::shared().parallelFor(others.size(), 4, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            distances[i] = pattern.compute(others[i]->getSequence(), maxDistance);
+        }
+    }, TaskScheduler::Priority::Batch);
+    return distances;
 }
 
 std::ostream& operator<<(ostream& os, const DNAStrand& WH) {
@@ -340,10 +463,10 @@ std::ostream& operator<<(ostream& os, const DNAStrand& WH) {
     return os;
 }
 
-void DNAStrand::drawNucleotides(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos) {
+void DNAStrand::drawNucleotides(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos) const {
     size_t end = rw.getSize().x / 12;
-    if (end > _sequence.length() - scrollPos) {
-        end = _sequence.length() - scrollPos;
+    if (end > _length - scrollPos) {
+        end = _length - scrollPos;
     }
     for (size_t i = scrollPos; i < end + scrollPos; i++) {
         sf::ConvexShape shape;
@@ -351,7 +474,7 @@ void DNAStrand::drawNucleotides(sf::RenderWindow& rw, sf::Vector2f startPosition
         shape.setPoint(0, sf::Vector2f(0, 0));
         shape.setPoint(1, sf::Vector2f(10, 0));
         shape.setPoint(2, sf::Vector2f(10, 20));
-        if (_sequence.at(i) == 'A' || _sequence.at(i) == 'G') {
+        if (_sequence[i] == 'A' || _sequence[i] == 'G') {
             shape.setPoint(3, sf::Vector2f(5, 14));
         } else {
             shape.setPoint(3, sf::Vector2f(5, 24));
@@ -359,11 +482,11 @@ void DNAStrand::drawNucleotides(sf::RenderWindow& rw, sf::Vector2f startPosition
         shape.setPoint(4, sf::Vector2f(0, 20));
         
         // set color based on nucleotide
-        if (_sequence.at(i) == 'A') {
+        if (_sequence[i] == 'A') {
             shape.setFillColor(sf::Color::Red);
-        } else if (_sequence.at(i) == 'T') {
+        } else if (_sequence[i] == 'T') {
             shape.setFillColor(sf::Color::Blue);
-        } else if (_sequence.at(i) == 'C') {
+        } else if (_sequence[i] == 'C') {
             shape.setFillColor(sf::Color::Green);
         } else {
             shape.setFillColor(sf::Color::Yellow);
@@ -374,11 +497,11 @@ void DNAStrand::drawNucleotides(sf::RenderWindow& rw, sf::Vector2f startPosition
     }
 }
 
-void DNAStrand::drawProteins(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos) {
+void DNAStrand::drawProteins(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos) const {
     int proteinScroll = scrollPos/3;
     size_t end = rw.getSize().x / 36 + 1;
-    if (end > _proteinSequence.size() - proteinScroll) {
-        end = _proteinSequence.size() - proteinScroll;
+    if (end > _codonCount - proteinScroll) {
+        end = _codonCount - proteinScroll;
     }
     for (size_t i = proteinScroll; i < end + proteinScroll; i++) {
         sf::ConvexShape shape;
@@ -390,7 +513,7 @@ void DNAStrand::drawProteins(sf::RenderWindow& rw, sf::Vector2f startPosition, i
         shape.setPoint(4, sf::Vector2f(0, 20));
         
         // set color based on protein
-        string protein = _proteinSequence.at(i)->findProtein();
+        string protein = _codons[i] == UNKNOWN_CODON ? "?" : Protein::getProteinName(_codons[i]);
         if (protein == "Phe") {
             shape.setFillColor(sf::Color::Green);
         } else if (protein == "Leu") {
@@ -444,10 +567,10 @@ void DNAStrand::drawProteins(sf::RenderWindow& rw, sf::Vector2f startPosition, i
     }
 }
 
-void DNAStrand::highlightNucleotideClusters(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos, vector<int>& clusterIndexes) {
+void DNAStrand::highlightNucleotideClusters(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos, vector<int>& clusterIndexes) const {
     size_t end = rw.getSize().x / 12;
-    if (end > _sequence.length() - scrollPos) {
-        end = _sequence.length() - scrollPos;
+    if (end > _length - scrollPos) {
+        end = _length - scrollPos;
     }
 
     for (size_t i = 0; i < clusterIndexes.size(); i++) {
@@ -471,11 +594,11 @@ void DNAStrand::highlightNucleotideClusters(sf::RenderWindow& rw, sf::Vector2f s
     }
 }
 
-void DNAStrand::highlightProteinClusters(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos, vector<int>& clusterIndexes) {
+void DNAStrand::highlightProteinClusters(sf::RenderWindow& rw, sf::Vector2f startPosition, int scrollPos, vector<int>& clusterIndexes) const {
     int proteinScroll = scrollPos/3;
     size_t end = rw.getSize().x / 36;
-    if (end > _sequence.length() - proteinScroll) {
-        end = _sequence.length() - proteinScroll;
+    if (end > _length - proteinScroll) {
+        end = _length - proteinScroll;
     }
 
     for (size_t i = 0; i < clusterIndexes.size(); i++) {
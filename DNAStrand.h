@@ -1,11 +1,35 @@
 #ifndef DNASTRAND_H
 #define DNASTRAND_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "Protein.h"
+#include "StrandArena.h"
 #include <SFML/Graphics.hpp>
 
+/**
+ * @brief One base change of a DNA strand, positioned in the unmodified sequence
+ * 
+ */
+struct Mutation {
+    enum Kind { Substitution, Insertion, Deletion };
+
+    Kind kind;
+    // base that is replaced or removed, or that the new base is inserted in front of
+    size_t position;
+    // new base of a substitution or insertion
+    char nucleotide;
+};
+
+/**
+ * @brief A DNA strand with its pair sequence, codons and amino acids, all kept in a StrandArena: the arena of
+ * a loaded species, or one of the strand's own. The strand does not know its species, since one strand is shared
+ * by every dataset holding its sequence; that is a property of the dataset
+ * 
+ */
 class DNAStrand {   
     public:
         /**
@@ -15,11 +39,18 @@ class DNAStrand {
         DNAStrand();
 
         /**
-         * @brief Construct new DNAStrand object from species name and sequence
+         * @brief Construct new DNAStrand object from species name and sequence, in an arena of its own
          * 
          */
         DNAStrand(std::string, std::string, int);
 
+        /**
+         * @brief Construct a DNAStrand whose data is placed in the given arena (named after the species),
+         * which must outlive it
+         * 
+         */
+        DNAStrand(StrandArena&, const std::string&, int);
+
         /**
          * @brief Copy constructor
          * 
@@ -27,6 +58,13 @@ class DNAStrand {
          */
         DNAStrand(const DNAStrand& copy);
 
+        /**
+         * @brief Move constructor, takes over the data without copying it
+         * 
+         * @param other 
+         */
+        DNAStrand(DNAStrand&& other) noexcept;
+
         /**
          * @brief Destroy the DNAStrand object
          * 
@@ -42,13 +80,22 @@ class DNAStrand {
         DNAStrand& operator=(const DNAStrand& other);
 
         /**
-         * @brief helper to deallocate memory of dna strand
+         * @brief move assignment operator
+         * 
+         * @param other 
+         * @return DNAStrand& 
+         */
+        DNAStrand& operator=(DNAStrand&& other) noexcept;
+
+        /**
+         * @brief helper to let go of the data of dna strand (in a shared arena, its space is
+         * only reused once the arena is freed)
          * 
          */
         void deallocate();
 
         /**
-         * @brief helper to deep copy memory of dna strand
+         * @brief helper to deep copy the data of dna strand into an arena of its own
          * 
          */
         void deepCopy(const DNAStrand&);
@@ -66,26 +113,32 @@ class DNAStrand {
         void createPairSequence();
 
         /**
-         * @brief Maps the current _sequence to a vector of its associated codons
+         * @brief Maps the current _pairSequence to the codon table index of each of its codons
          * 
          */
         void createCodonSequence();
 
         /**
-         * @brief Maps the current _codonSequence to a vector of its associated proteins
+         * @brief Maps the current _codons to the amino acid number of each of their proteins
          * 
          */
         void createProteinSequence();
 
+        /**
+         * @brief Rebuilds the codon and protein at the given codon index from the pair sequence
+         * 
+         */
+        void updateCodon(size_t);
+
         /**
          * @brief Get the Sequence object
          * 
-         * @return std::string const DNA Sequence
+         * @return std::string_view DNA Sequence, valid while the strand is
          */
-        std::string getSequence() const;
+        std::string_view getSequence() const;
 
         /**
-         * @brief Set the Sequence object
+         * @brief Set the Sequence object, rebuilding the pair sequence, codons and proteins
          * 
          */
         void setSequence(std::string);
@@ -93,16 +146,38 @@ class DNAStrand {
         /**
          * @brief Get the Pair Sequence object
          * 
-         * @return std::string pair sequence
+         * @return std::string_view pair sequence, valid while the strand is
+         */
+        std::string_view getPairSequence() const;
+
+        /**
+         * @brief Get the number of proteins (one per codon, a partial last codon included)
+         * 
+         * @return size_t
+         */
+        size_t getProteinCount() const;
+
+        /**
+         * @brief Get the amino acid number of every protein (see translateCodons)
+         * 
+         * @return const uint8_t* getProteinCount() amino acids
+         */
+        const uint8_t* getAminoAcids() const;
+
+        /**
+         * @brief Get the reverse complement of the DNA sequence
+         * 
+         * @return std::string reverse complement sequence
          */
-        std::string getPairSequence() const;
+        std::string getReverseComplement() const;
 
         /**
-         * @brief Get the Protein Sequence object
+         * @brief Get the Protein Sequence object, built from the codons and labelled with the given species
+         * (a strand interned by several datasets is shared by their species, so it has no single one)
          * 
          * @return vector<Protein> 
          */
-        std::vector<Protein*> getProteinSequence() const;
+        std::vector<Protein> getProteinSequence(const std::string&) const;
 
         /**
          * @brief Modify the nucelotide at given index
@@ -116,63 +191,109 @@ class DNAStrand {
          */
         void modifyCodon(int, std::string);
 
+        /**
+         * @brief Apply a batch of mutations sorted by position, rebuilding each changed codon once
+         * (or the derived data once if the length changes)
+         * 
+         */
+        void applyMutations(const std::vector<Mutation>&);
+
+        /**
+         * @brief Write a sequence with a batch of mutations sorted by position applied into out
+         * 
+         */
+        static void applyMutations(std::string_view, const std::vector<Mutation>&, std::string&);
+
         /**
          * @brief  Find the percentage of the two DNA strands that share similarity
          * 
          */
-        double compareDNA(DNAStrand&) const;
+        double compareDNA(const DNAStrand&) const;
 
         /**
          * @brief Find similarity clusters of nucleotides
          * 
          * @return std::vector<int> clusters
          */
-        std::vector<int> findClusters(DNAStrand&) const;
+        std::vector<int> findClusters(const DNAStrand&) const;
 
         /**
          * @brief Find the percentage of the protein sequences of the two DNA strands that share similarity
          * 
          * @return double 
          */
-        double compareProteins(DNAStrand&) const;
+        double compareProteins(const DNAStrand&) const;
 
         /**
          * @brief Find similarity clusters of proteins
          * 
          * @return std::vector<int> clusters
          */
-        std::vector<int> findProteinClusters(DNAStrand&) const;
+        std::vector<int> findProteinClusters(const DNAStrand&) const;
+
+        /**
+         * @brief Find the number of nucleotide insertions, deletions and substitutions between the
+         * two DNA strands; with maxDistance >= 0 the search stops at maxDistance + 1
+         * 
+         * @return int edit distance
+         */
+        int editDistance(const DNAStrand&, int = -1) const;
+
+        /**
+         * @brief Find the edit distance to each of the given DNA strands in parallel, reusing the
+         * bit masks of this strand for every comparison
+         * 
+         * @return std::vector<int> edit distances in the order of the given strands
+         */
+        std::vector<int> editDistances(const std::vector<const DNAStrand*>&, int = -1) const;
 
         /**
          * @brief Uses SMFL Library to display the given DNA Strand
          * 
          */
-        void drawNucleotides(sf::RenderWindow&, sf::Vector2f, int);
+        void drawNucleotides(sf::RenderWindow&, sf::Vector2f, int) const;
 
         /**
          * @brief Uses SMFL Library to display the given Protein Sequence
          * 
          */
-        void drawProteins(sf::RenderWindow&, sf::Vector2f, int);
+        void drawProteins(sf::RenderWindow&, sf::Vector2f, int) const;
 
         /**
          * @brief highlights the nucleotide clusters found
          * 
          */
-        void highlightNucleotideClusters(sf::RenderWindow&, sf::Vector2f, int, std::vector<int>&);
+        void highlightNucleotideClusters(sf::RenderWindow&, sf::Vector2f, int, std::vector<int>&) const;
 
         /**
          * @brief highlights the protein clusters found
          * 
          */
-        void highlightProteinClusters(sf::RenderWindow&, sf::Vector2f, int, std::vector<int>&);
+        void highlightProteinClusters(sf::RenderWindow&, sf::Vector2f, int, std::vector<int>&) const;
     private:
-        std::string _sourceSpecies;
+        /**
+         * @brief Give the strand a new arena of its own, named after the given species
+         * 
+         */
+        void useOwnArena(const std::string&);
+
+        /**
+         * @brief Take room in the arena for a sequence of the given length and its derived data
+         * 
+         */
+        void allocateData(size_t);
+
+        // the arena holding the data, which is _ownArena unless the strand belongs to a loaded species
+        StrandArena* _arena;
+        std::shared_ptr<StrandArena> _ownArena;
         int _class;
-        std::string _sequence;
-        std::string _pairSequence;
-        std::vector<std::string> _codonSequence;
-        std::vector<Protein*> _proteinSequence;
+        size_t _length;
+        char* _sequence;
+        char* _pairSequence;
+        // one per codon: its codon table index, and the amino acid number of its protein, which the comparisons read
+        size_t _codonCount;
+        uint8_t* _codons;
+        uint8_t* _aminoAcids;
 };
 
 std::ostream& operator<<(std::ostream&, const DNAStrand&);
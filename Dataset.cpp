@@ -0,0 +1,249 @@
+#include "Dataset.h"
+#include "DNAStrand.h"
+#include "MemoryAccounting.h"
+#include "StrandArena.h"
+#include "StrandStore.h"
+#include "TaskScheduler.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const size_t MAX_CHUNK_SIZE = 256;
+}
+
+/**
+ * @brief Construct an empty Dataset for the species read from datasets/<name>.txt
+ *
+ */
+Dataset::Dataset(string name) {
+    _name = name;
+    _arena = make_shared<StrandArena>(name);
+    _available = 0;
+    _bytesRead = 0;
+    _fileSize = 0;
+    _loaded = false;
+    _failed = false;
+}
+
+/**
+ * @brief Cancel a load in progress and wait for it to stop
+ *
+ */
+Dataset::~Dataset() {
+    _loadToken.cancel();
+    _loadTask.wait();
+}
+
+/**
+ * @brief Read the dataset file on the calling thread
+ *
+ * @return bool whether the file could be opened
+ */
+bool Dataset::load() {
+    readFile(_loadToken);
+    return !_failed;
+}
+
+/**
+ * @brief Read the dataset file on the shared scheduler, publishing strands as they are built
+ *
+ */
+void Dataset::loadAsync(TaskScheduler::Priority priority) {
+    CancelToken token = _loadToken;
+    _loadTask = TaskScheduler::shared().submit([this, token]() {
+        readFile(token);
+    }, priority, token);
+}
+
+/**
+ * @brief Block until a background load is done
+ *
+ */
+void Dataset::waitUntilLoaded() const {
+    _loadTask.wait();
+}
+
+/**
+ * @brief Get the species name
+ *
+ * @return std::string
+ */
+string Dataset::getName() const {
+    return _name;
+}
+
+/**
+ * @brief Get the number of strands that are built and safe to read
+ *
+ * @return size_t
+ */
+size_t Dataset::getAvailableCount() const {
+    return _available;
+}
+
+/**
+ * @brief Check whether the whole file has been read
+ *
+ * @return bool
+ */
+bool Dataset::isLoaded() const {
+    return _loaded;
+}
+
+/**
+ * @brief Check whether the file could not be opened
+ *
+ * @return bool
+ */
+bool Dataset::hasFailed() const {
+    return _failed;
+}
+
+/**
+ * @brief Get the fraction of the file read so far (0 to 1)
+ *
+ * @return float
+ */
+float Dataset::getProgress() const {
+    if (_loaded) {
+        return 1;
+    }
+    if (_fileSize == 0) {
+        return 0;
+    }
+    return (float)_bytesRead / (float)_fileSize;
+}
+
+/**
+ * @brief Get an available strand
+ *
+ * @return const DNAStrand&
+ */
+const DNAStrand& Dataset::at(size_t index) const {
+    return *getStrand(index);
+}
+
+/**
+ * @brief Get the shared handle of an available strand, identical sequences in any
+ * loaded dataset share one strand
+ *
+ * @return std::shared_ptr<const DNAStrand>
+ */
+shared_ptr<const DNAStrand> Dataset::getStrand(size_t index) const {
+    if (index >= _available) {
+        throw out_of_range("strand " + to_string(index) + " of " + _name + " is not loaded");
+    }
+    lock_guard<mutex> lock(_mutex);
+    return _strands[index].strand;
+}
+
+/**
+ * @brief Get the class number the dataset file gives an available strand
+ *
+ * @return int
+ */
+int Dataset::getClass(size_t index) const {
+    if (index >= _available) {
+        throw out_of_range("strand " + to_string(index) + " of " + _name + " is not loaded");
+    }
+    lock_guard<mutex> lock(_mutex);
+    return _strands[index].classNum;
+}
+
+/**
+ * @brief Get the column table of every strand, empty until the dataset is loaded
+ *
+ * @return const StrandTable&
+ */
+const StrandTable& Dataset::getTable() const {
+    return _table;
+}
+
+/**
+ * @brief Get the arena holding the strands this dataset built and their data
+ *
+ * @return const StrandArena&
+ */
+const StrandArena& Dataset::getArena() const {
+    return *_arena;
+}
+
+/**
+ * @brief Parse the file in growing chunks, building each chunk's strands in parallel
+ *
+ */
+void Dataset::readFile(const CancelToken& token) {
+    MemoryScope scope(MemoryTag::Loaders);
+    ifstream fin("datasets/"+ _name + ".txt");
+    // check if there is an error
+    if (fin.fail()) {
+        cerr <<  "Error opening \'" + _name + ".txt\' file";
+        _failed = true;
+        _loaded = true;
+        return;
+    }
+
+    fin.seekg(0, ios::end);
+    _fileSize = (size_t)fin.tellg();
+    fin.seekg(0, ios::beg);
+
+    string header;
+    fin >> header >> header;
+
+    // start with a single strand so the first one shows up right away, then grow the chunks
+    size_t chunkSize = 1;
+    vector<string> dnaLines;
+    vector<int> classNums;
+    while (!token.isCancelled()) {
+        dnaLines.clear();
+        classNums.clear();
+        string dnaLine;
+        int classNum;
+        while (dnaLines.size() < chunkSize && fin >> dnaLine >> classNum) {
+            dnaLines.push_back(dnaLine);
+            classNums.push_back(classNum);
+        }
+        if (dnaLines.empty()) {
+            break;
+        }
+
+        // slots past _available are only touched by the loader, so they can be filled without the lock
+        size_t first = _available;
+        {
+            lock_guard<mutex> lock(_mutex);
+            _strands.resize(first + dnaLines.size());
+        }
+        TaskScheduler::shared().parallelFor(dnaLines.size(), 16, [&](size_t start, size_t end) {
+            for (size_t i = start; i < end; i++) {
+                _strands[first + i].strand = StrandStore::shared().intern(dnaLines[i], _arena);
+                _strands[first + i].classNum = classNums[i];
+            }
+        }, TaskScheduler::Priority::Batch);
+
+        _available = first + dnaLines.size();
+        streamoff position = fin.tellg();
+        if (position > 0) {
+            _bytesRead = (size_t)position;
+        }
+        chunkSize = chunkSize * 2 < MAX_CHUNK_SIZE ? chunkSize * 2 : MAX_CHUNK_SIZE;
+    }
+
+    // the table is complete before anyone sees the dataset as loaded
+    if (!token.isCancelled()) {
+        vector<shared_ptr<const DNAStrand>> strands(_available);
+        vector<int> classes(_available);
+        for (size_t i = 0; i < strands.size(); i++) {
+            strands[i] = _strands[i].strand;
+            classes[i] = _strands[i].classNum;
+        }
+        _table.build(strands, classes);
+    }
+    _loaded = true;
+}
@@ -0,0 +1,150 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "DNAStrand.h"
+#include "StrandArena.h"
+#include "StrandTable.h"
+#include "TaskScheduler.h"
+
+class Dataset {
+    public:
+        /**
+         * @brief Construct an empty Dataset for the species read from datasets/<name>.txt
+         *
+         */
+        explicit Dataset(std::string);
+
+        /**
+         * @brief Cancel a load in progress and wait for it to stop
+         *
+         */
+        ~Dataset();
+
+        Dataset(const Dataset&) = delete;
+        Dataset& operator=(const Dataset&) = delete;
+
+        /**
+         * @brief Read the dataset file on the calling thread
+         *
+         * @return bool whether the file could be opened
+         */
+        bool load();
+
+        /**
+         * @brief Read the dataset file on the shared scheduler, publishing strands as they are built
+         *
+         */
+        void loadAsync(TaskScheduler::Priority);
+
+        /**
+         * @brief Block until a background load is done
+         *
+         */
+        void waitUntilLoaded() const;
+
+        /**
+         * @brief Get the species name
+         *
+         * @return std::string
+         */
+        std::string getName() const;
+
+        /**
+         * @brief Get the number of strands that are built and safe to read
+         *
+         * @return size_t
+         */
+        size_t getAvailableCount() const;
+
+        /**
+         * @brief Check whether the whole file has been read
+         *
+         * @return bool
+         */
+        bool isLoaded() const;
+
+        /**
+         * @brief Check whether the file could not be opened
+         *
+         * @return bool
+         */
+        bool hasFailed() const;
+
+        /**
+         * @brief Get the fraction of the file read so far (0 to 1)
+         *
+         * @return float
+         */
+        float getProgress() const;
+
+        /**
+         * @brief Get an available strand
+         *
+         * @return const DNAStrand&
+         */
+        const DNAStrand& at(size_t) const;
+
+        /**
+         * @brief Get the shared handle of an available strand, identical sequences in any
+         * loaded dataset share one strand
+         *
+         * @return std::shared_ptr<const DNAStrand>
+         */
+        std::shared_ptr<const DNAStrand> getStrand(size_t) const;
+
+        /**
+         * @brief Get the class number the dataset file gives an available strand
+         *
+         * @return int
+         */
+        int getClass(size_t) const;
+
+        /**
+         * @brief Get the column table of every strand, empty until the dataset is loaded
+         *
+         * @return const StrandTable&
+         */
+        const StrandTable& getTable() const;
+
+        /**
+         * @brief Get the arena holding the strands this dataset built and their data
+         *
+         * @return const StrandArena&
+         */
+        const StrandArena& getArena() const;
+
+    private:
+        /**
+         * @brief Parse the file in growing chunks, building each chunk's strands in parallel
+         *
+         */
+        void readFile(const CancelToken&);
+
+        struct Entry {
+            std::shared_ptr<const DNAStrand> strand;
+            int classNum = 0;
+        };
+
+        std::string _name;
+        // strands first seen in this dataset live here; it is freed in one go once none of them is in use
+        std::shared_ptr<StrandArena> _arena;
+        // a deque keeps references stable while the loader appends
+        std::deque<Entry> _strands;
+        mutable std::mutex _mutex;
+        std::atomic<size_t> _available;
+        std::atomic<size_t> _bytesRead;
+        std::atomic<size_t> _fileSize;
+        std::atomic<bool> _loaded;
+        std::atomic<bool> _failed;
+        TaskHandle _loadTask;
+        CancelToken _loadToken;
+        StrandTable _table;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "EditDistance.h"
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief Advance one 64-row block by one text character (Hyyrö's formulation of Myers' step)
+     *
+     * @return int horizontal difference leaving the block's highest row (-1, 0 or +1)
+     */
+    int advanceBlock(uint64_t& positive, uint64_t& negative, uint64_t matches, int carryIn, uint64_t highBit) {
+        uint64_t vertical = matches | negative;
+        if (carryIn < 0) {
+            matches |= 1;
+        }
+        uint64_t horizontal = (((matches & positive) + positive) ^ positive) | matches;
+        uint64_t horizontalPositive = negative | ~(horizontal | positive);
+        uint64_t horizontalNegative = positive & horizontal;
+
+        int carryOut = 0;
+        if (horizontalPositive & highBit) {
+            carryOut = 1;
+        } else if (horizontalNegative & highBit) {
+            carryOut = -1;
+        }
+
+        horizontalPositive <<= 1;
+        horizontalNegative <<= 1;
+        if (carryIn < 0) {
+            horizontalNegative |= 1;
+        } else if (carryIn > 0) {
+            horizontalPositive |= 1;
+        }
+        positive = horizontalNegative | ~(vertical | horizontalPositive);
+        negative = horizontalPositive & vertical;
+        return carryOut;
+    }
+
+    int capDistance(size_t distance, int maxDistance) {
+        if (maxDistance >= 0 && distance > (size_t)maxDistance) {
+            return maxDistance + 1;
+        }
+        return (int)distance;
+    }
+}
+
+/**
+ * @brief Precompute the match masks of the pattern
+ *
+ */
+EditDistance::EditDistance(string_view pattern) {
+    _pattern = string(pattern);
+    _blockCount = (pattern.size() + WORD_BITS - 1) / WORD_BITS;
+
+    // give every distinct character of the pattern its own row of masks
+    fill(_maskIndex, _maskIndex + 256, (uint16_t)0);
+    size_t rows = 1;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        uint8_t character = (uint8_t)pattern[i];
+        if (_maskIndex[character] == 0) {
+            _maskIndex[character] = (uint16_t)rows++;
+        }
+    }
+
+    _matchMasks.assign(rows * _blockCount, 0);
+    for (size_t i = 0; i < pattern.size(); i++) {
+        size_t row = _maskIndex[(uint8_t)pattern[i]];
+        _matchMasks[row * _blockCount + i / WORD_BITS] |= (uint64_t)1 << (i % WORD_BITS);
+    }
+}
+
+/**
+ * @brief Get the edit distance from the pattern to the text; with maxDistance >= 0 only a band of
+ * that width is computed and maxDistance + 1 is returned as soon as the distance must exceed it
+ *
+ * @return int
+ */
+int EditDistance::compute(string_view text, int maxDistance) const {
+    size_t patternLength = _pattern.size();
+    size_t textLength = text.size();
+    if (patternLength == 0) {
+        return capDistance(textLength, maxDistance);
+    }
+    if (textLength == 0) {
+        return capDistance(patternLength, maxDistance);
+    }
+    size_t lengthDifference = patternLength > textLength ? patternLength - textLength : textLength - patternLength;
+    if (maxDistance >= 0 && lengthDifference > (size_t)maxDistance) {
+        return maxDistance + 1;
+    }
+
+    size_t finalBlock = _blockCount - 1;
+    uint64_t finalHighBit = (uint64_t)1 << ((patternLength - 1) % WORD_BITS);
+
+    // rows below column + maxDistance can't be within the threshold, so their blocks start late
+    size_t lastBlock = finalBlock;
+    if (maxDistance >= 0) {
+        lastBlock = min(finalBlock, (size_t)maxDistance / WORD_BITS);
+    }
+
+    // column 0 is the distance from each pattern prefix to the empty text: +1 per row
+    vector<uint64_t> positive(_blockCount, ~(uint64_t)0);
+    vector<uint64_t> negative(_blockCount, 0);
+    vector<long long> score(_blockCount);
+    for (size_t b = 0; b < _blockCount; b++) {
+        score[b] = (long long)min(patternLength, (b + 1) * WORD_BITS);
+    }
+
+    for (size_t j = 0; j < textLength; j++) {
+        if (maxDistance >= 0) {
+            size_t neededBlock = min(finalBlock, (j + (size_t)maxDistance) / WORD_BITS);
+            while (lastBlock < neededBlock) {
+                // a block entering the band starts as an upper bound: +1 per row below the block above
+                lastBlock++;
+                positive[lastBlock] = ~(uint64_t)0;
+                negative[lastBlock] = 0;
+                score[lastBlock] = score[lastBlock - 1] + (long long)(min(patternLength, (lastBlock + 1) * WORD_BITS) - lastBlock * WORD_BITS);
+            }
+        }
+
+        const uint64_t* matches = &_matchMasks[_maskIndex[(uint8_t)text[j]] * _blockCount];
+        // the top row grows by one per text character
+        int carry = 1;
+        for (size_t b = 0; b <= lastBlock; b++) {
+            uint64_t highBit = b == finalBlock ? finalHighBit : (uint64_t)1 << (WORD_BITS - 1);
+            carry = advanceBlock(positive[b], negative[b], matches[b], carry, highBit);
+            score[b] += carry;
+        }
+
+        // the remaining characters can lower the distance by at most one each
+        if (maxDistance >= 0 && lastBlock == finalBlock && score[finalBlock] - (long long)(textLength - 1 - j) > maxDistance) {
+            return maxDistance + 1;
+        }
+    }
+
+    return capDistance((size_t)score[finalBlock], maxDistance);
+}
+
+/**
+ * @brief Get the edit distance between two sequences (see compute)
+ *
+ * @return int
+ */
+int EditDistance::between(string_view first, string_view second, int maxDistance) {
+    // the shorter sequence as the pattern means fewer blocks per column
+    if (first.size() <= second.size()) {
+        return EditDistance(first).compute(second, maxDistance);
+    }
+    return EditDistance(second).compute(first, maxDistance);
+}
+
+/**
+ * @brief Get the edit distance with the textbook cell-by-cell dynamic program, for checking the
+ * bit-parallel one against
+ *
+ * @return int
+ */
+int EditDistance::betweenNaive(string_view first, string_view second) {
+    vector<int> previous(second.size() + 1);
+    vector<int> current(second.size() + 1);
+    for (size_t j = 0; j <= second.size(); j++) {
+        previous[j] = (int)j;
+    }
+    for (size_t i = 1; i <= first.size(); i++) {
+        current[0] = (int)i;
+        for (size_t j = 1; j <= second.size(); j++) {
+            int substitution = previous[j - 1] + (first[i - 1] == second[j - 1] ? 0 : 1);
+            current[j] = min(substitution, min(previous[j], current[j - 1]) + 1);
+        }
+        swap(previous, current);
+    }
+    return previous[second.size()];
+}
@@ -0,0 +1,57 @@
+#ifndef EDITDISTANCE_H
+#define EDITDISTANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Bit-parallel (Myers/Hyyrö) Levenshtein distance against a fixed pattern, 64 rows per
+ * machine word, so one pattern can be screened against many texts
+ *
+ */
+class EditDistance {
+    public:
+        /**
+         * @brief Precompute the match masks of the pattern
+         *
+         */
+        explicit EditDistance(std::string_view);
+
+        /**
+         * @brief Get the edit distance from the pattern to the text; with maxDistance >= 0 only a band of
+         * that width is computed and maxDistance + 1 is returned as soon as the distance must exceed it
+         *
+         * @return int
+         */
+        int compute(std::string_view, int = -1) const;
+
+        /**
+         * @brief Get the edit distance between two sequences (see compute)
+         *
+         * @return int
+         */
+        static int between(std::string_view, std::string_view, int = -1);
+
+        /**
+         * @brief Get the edit distance with the textbook cell-by-cell dynamic program, for checking the
+         * bit-parallel one against
+         *
+         * @return int
+         */
+        static int betweenNaive(std::string_view, std::string_view);
+
+    private:
+        static const size_t WORD_BITS = 64;
+
+        std::string _pattern;
+        size_t _blockCount;
+        // row of each character in _matchMasks, 0 for characters missing from the pattern
+        uint16_t _maskIndex[256];
+        // per distinct pattern character, one bit per pattern row; row 0 is all zeros
+        std::vector<uint64_t> _matchMasks;
+};
+
+#endif
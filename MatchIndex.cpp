@@ -0,0 +1,250 @@
+#include "MatchIndex.h"
+#include "analysis_kernels.h"
+#include "DNAStrand.h"
+#include "MemoryAccounting.h"
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    size_t popcount(uint64_t word) {
+#if defined(__GNUC__)
+        return (size_t)__builtin_popcountll(word);
+#else
+        return bitset<64>(word).count();
+#endif
+    }
+}
+
+/**
+ * @brief Construct an empty MatchIndex
+ *
+ */
+MatchIndex::MatchIndex() {
+}
+
+/**
+ * @brief Construct a MatchIndex for the given pair of strands
+ *
+ */
+MatchIndex::MatchIndex(const DNAStrand& first, const DNAStrand& second) {
+    build(first, second);
+}
+
+/**
+ * @brief Record the positional matches of the two strands at nucleotide and protein level
+ *
+ */
+void MatchIndex::build(const DNAStrand& first, const DNAStrand& second) {
+    MemoryScope scope(MemoryTag::Indexes);
+    // nucleotide matches over the shared length
+    string_view firstSequence = first.getSequence();
+    string_view secondSequence = second.getSequence();
+    size_t end = firstSequence.size();
+    if (secondSequence.size() < end) {
+        end = secondSequence.size();
+    }
+
+    vector<bool> matches(end);
+    for (size_t i = 0; i < end; i++) {
+        matches[i] = firstSequence[i] == secondSequence[i];
+    }
+    _nucleotideMatches.build(matches);
+
+    // protein matches, unknown codons never count as a match (same rule as compareProteins)
+    const uint8_t* firstAminoAcids = first.getAminoAcids();
+    const uint8_t* secondAminoAcids = second.getAminoAcids();
+    end = first.getProteinCount();
+    if (second.getProteinCount() < end) {
+        end = second.getProteinCount();
+    }
+
+    matches.assign(end, false);
+    for (size_t i = 0; i < end; i++) {
+        matches[i] = SymbolMatch<Alphabet::AminoAcid, Encoding::Byte>::at(firstAminoAcids, secondAminoAcids, i);
+    }
+    _proteinMatches.build(matches);
+}
+
+/**
+ * @brief Get the number of nucleotide positions shared by both strands
+ *
+ * @return size_t
+ */
+size_t MatchIndex::getNucleotideLength() const {
+    return _nucleotideMatches.length;
+}
+
+/**
+ * @brief Get the number of protein positions shared by both strands
+ *
+ * @return size_t
+ */
+size_t MatchIndex::getProteinLength() const {
+    return _proteinMatches.length;
+}
+
+/**
+ * @brief Count the matching nucleotides in the range [start, end)
+ *
+ * @return size_t
+ */
+size_t MatchIndex::countNucleotideMatches(size_t start, size_t end) const {
+    if (end > _nucleotideMatches.length) {
+        end = _nucleotideMatches.length;
+    }
+    if (start >= end) {
+        return 0;
+    }
+    return _nucleotideMatches.rank(end) - _nucleotideMatches.rank(start);
+}
+
+/**
+ * @brief Count the matching proteins in the range [start, end)
+ *
+ * @return size_t
+ */
+size_t MatchIndex::countProteinMatches(size_t start, size_t end) const {
+    if (end > _proteinMatches.length) {
+        end = _proteinMatches.length;
+    }
+    if (start >= end) {
+        return 0;
+    }
+    return _proteinMatches.rank(end) - _proteinMatches.rank(start);
+}
+
+/**
+ * @brief Find the percentage of nucleotides in the range [start, end) that share similarity
+ *
+ * @return double
+ */
+double MatchIndex::compareDNA(size_t start, size_t end) const {
+    if (end > _nucleotideMatches.length) {
+        end = _nucleotideMatches.length;
+    }
+    if (start >= end) {
+        return 0;
+    }
+    return (double)countNucleotideMatches(start, end) / (double)(end - start) * 100;
+}
+
+/**
+ * @brief Find the percentage of proteins in the range [start, end) that share similarity
+ *
+ * @return double
+ */
+double MatchIndex::compareProteins(size_t start, size_t end) const {
+    if (end > _proteinMatches.length) {
+        end = _proteinMatches.length;
+    }
+    if (start >= end) {
+        return 0;
+    }
+    return (double)countProteinMatches(start, end) / (double)(end - start) * 100;
+}
+
+/**
+ * @brief Count the matching nucleotides of every window of the given width (window i starts at
+ * nucleotide i), two rank lookups a window whatever the width
+ *
+ * @return std::vector<uint32_t>
+ */
+vector<uint32_t> MatchIndex::countNucleotideWindows(size_t width) const {
+    return _nucleotideMatches.countWindows(width);
+}
+
+/**
+ * @brief Count the matching proteins of every window of the given width (window i starts at
+ * protein i), two rank lookups a window whatever the width
+ *
+ * @return std::vector<uint32_t>
+ */
+vector<uint32_t> MatchIndex::countProteinWindows(size_t width) const {
+    return _proteinMatches.countWindows(width);
+}
+
+/**
+ * @brief Find similarity clusters of nucleotide windows of the given width from the index, the same
+ * windows DNAStrand::findClusters finds at CLUSTER_WIDTH
+ *
+ * @return std::vector<int> clusters
+ */
+vector<int> MatchIndex::findClusters(size_t width) const {
+    // every window, starting from windows a width apart
+    vector<uint32_t> counts = countNucleotideWindows(width);
+    return findClusterWindows(counts.data(), counts.size(), width, width);
+}
+
+/**
+ * @brief Find similarity clusters of protein windows of the given width from the index, the same
+ * windows DNAStrand::findProteinClusters finds at CLUSTER_WIDTH
+ *
+ * @return std::vector<int> clusters
+ */
+vector<int> MatchIndex::findProteinClusters(size_t width) const {
+    // every window but the last, starting from the first few, as DNAStrand::findProteinClusters
+    vector<uint32_t> counts = countProteinWindows(width);
+    return findClusterWindows(counts.data(), counts.empty() ? 0 : counts.size() - 1, width, 1);
+}
+
+/**
+ * @brief Pack the match flags into words and sample the running count at every checkpoint
+ *
+ */
+void MatchIndex::RankBits::build(const vector<bool>& bits) {
+    length = bits.size();
+    words.assign((length + 63) / 64, 0);
+    for (size_t i = 0; i < length; i++) {
+        if (bits[i]) {
+            words[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+
+    checkpoints.assign(words.size() / CHECKPOINT_WORDS + 1, 0);
+    uint32_t total = 0;
+    for (size_t i = 0; i < words.size(); i++) {
+        if (i % CHECKPOINT_WORDS == 0) {
+            checkpoints[i / CHECKPOINT_WORDS] = total;
+        }
+        total += (uint32_t)popcount(words[i]);
+    }
+    if (words.size() % CHECKPOINT_WORDS == 0) {
+        checkpoints.back() = total;
+    }
+}
+
+/**
+ * @brief Count the set bits before the given position
+ *
+ */
+size_t MatchIndex::RankBits::rank(size_t position) const {
+    size_t word = position / 64;
+    size_t count = checkpoints[word / CHECKPOINT_WORDS];
+    for (size_t i = word - word % CHECKPOINT_WORDS; i < word; i++) {
+        count += popcount(words[i]);
+    }
+    if (position % 64 != 0) {
+        count += popcount(words[word] & (((uint64_t)1 << (position % 64)) - 1));
+    }
+    return count;
+}
+
+/**
+ * @brief Count the set bits of every window of the given width
+ *
+ */
+vector<uint32_t> MatchIndex::RankBits::countWindows(size_t width) const {
+    vector<uint32_t> counts;
+    if (width == 0 || width > length) {
+        return counts;
+    }
+    counts.resize(length - width + 1);
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] = (uint32_t)(rank(i + width) - rank(i));
+    }
+    return counts;
+}
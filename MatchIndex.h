@@ -0,0 +1,126 @@
+#ifndef MATCHINDEX_H
+#define MATCHINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "analysis_kernels.h"
+#include "DNAStrand.h"
+
+class MatchIndex {
+    public:
+        /**
+         * @brief Construct an empty MatchIndex
+         *
+         */
+        MatchIndex();
+
+        /**
+         * @brief Construct a MatchIndex for the given pair of strands
+         *
+         */
+        MatchIndex(const DNAStrand&, const DNAStrand&);
+
+        /**
+         * @brief Record the positional matches of the two strands at nucleotide and protein level
+         *
+         */
+        void build(const DNAStrand&, const DNAStrand&);
+
+        /**
+         * @brief Get the number of nucleotide positions shared by both strands
+         *
+         * @return size_t
+         */
+        size_t getNucleotideLength() const;
+
+        /**
+         * @brief Get the number of protein positions shared by both strands
+         *
+         * @return size_t
+         */
+        size_t getProteinLength() const;
+
+        /**
+         * @brief Count the matching nucleotides in the range [start, end)
+         *
+         * @return size_t
+         */
+        size_t countNucleotideMatches(size_t, size_t) const;
+
+        /**
+         * @brief Count the matching proteins in the range [start, end)
+         *
+         * @return size_t
+         */
+        size_t countProteinMatches(size_t, size_t) const;
+
+        /**
+         * @brief Find the percentage of nucleotides in the range [start, end) that share similarity
+         *
+         * @return double
+         */
+        double compareDNA(size_t, size_t) const;
+
+        /**
+         * @brief Find the percentage of proteins in the range [start, end) that share similarity
+         *
+         * @return double
+         */
+        double compareProteins(size_t, size_t) const;
+
+        /**
+         * @brief Count the matching nucleotides of every window of the given width (window i starts at
+         * nucleotide i), two rank lookups a window whatever the width
+         *
+         * @return std::vector<uint32_t>
+         */
+        std::vector<uint32_t> countNucleotideWindows(size_t) const;
+
+        /**
+         * @brief Count the matching proteins of every window of the given width (window i starts at
+         * protein i), two rank lookups a window whatever the width
+         *
+         * @return std::vector<uint32_t>
+         */
+        std::vector<uint32_t> countProteinWindows(size_t) const;
+
+        /**
+         * @brief Find similarity clusters of nucleotide windows of the given width from the index, the same
+         * windows DNAStrand::findClusters finds at CLUSTER_WIDTH
+         *
+         * @return std::vector<int> clusters
+         */
+        std::vector<int> findClusters(size_t = CLUSTER_WIDTH) const;
+
+        /**
+         * @brief Find similarity clusters of protein windows of the given width from the index, the same
+         * windows DNAStrand::findProteinClusters finds at CLUSTER_WIDTH
+         *
+         * @return std::vector<int> clusters
+         */
+        std::vector<int> findProteinClusters(size_t = CLUSTER_WIDTH) const;
+
+    private:
+        /**
+         * @brief Bit vector with a cumulative count sampled every CHECKPOINT_WORDS words,
+         * so rank queries take one lookup and a bounded number of popcounts
+         *
+         */
+        struct RankBits {
+            std::vector<uint64_t> words;
+            std::vector<uint32_t> checkpoints;
+            size_t length = 0;
+
+            void build(const std::vector<bool>&);
+            size_t rank(size_t) const;
+            std::vector<uint32_t> countWindows(size_t) const;
+        };
+
+        static const size_t CHECKPOINT_WORDS = 8;
+
+        RankBits _nucleotideMatches;
+        RankBits _proteinMatches;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include "MemoryAccounting.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // in front of every block: its size and tag, padded so the block keeps the alignment malloc gives
+    struct alignas(alignof(max_align_t)) BlockHeader {
+        uint64_t size;
+        uint32_t tag;
+    };
+
+    struct Counters {
+        atomic<uint64_t> liveBytes;
+        atomic<uint64_t> peakBytes;
+        atomic<uint64_t> allocationCount;
+        atomic<uint64_t> liveAllocationCount;
+    };
+
+    // changes a thread has not added to the shared counters yet, so most allocations touch no shared memory
+    struct Pending {
+        int64_t bytes[MemoryAccounting::TAG_COUNT];
+        int64_t allocations[MemoryAccounting::TAG_COUNT];
+        int64_t frees[MemoryAccounting::TAG_COUNT];
+        uint32_t operations[MemoryAccounting::TAG_COUNT];
+
+        // hand the rest over when the thread exits, so what a finished worker did is not lost
+        ~Pending();
+    };
+
+    const int64_t FLUSH_BYTES = 16 * 1024;
+    const uint32_t FLUSH_OPERATIONS = 256;
+
+    // zero initialized before anything runs, so allocations made during static initialization are counted too
+    Counters tagCounters[MemoryAccounting::TAG_COUNT];
+    Counters totalCounters;
+
+    thread_local MemoryTag currentTag = MemoryTag::Other;
+    thread_local Pending pending;
+
+    const char* TAG_NAMES[MemoryAccounting::TAG_COUNT] = {"other", "sequences", "pair sequences", "codons", "proteins", "loaders", "indexes", "caches", "render"};
+
+    // add signed changes to shared counters (unsigned arithmetic wraps back correctly) and raise the peak
+    void apply(Counters& counters, int64_t bytes, int64_t allocations, int64_t frees) {
+        uint64_t live = counters.liveBytes.fetch_add((uint64_t)bytes, memory_order_relaxed) + (uint64_t)bytes;
+        counters.allocationCount.fetch_add((uint64_t)allocations, memory_order_relaxed);
+        counters.liveAllocationCount.fetch_add((uint64_t)(allocations - frees), memory_order_relaxed);
+        uint64_t peak = counters.peakBytes.load(memory_order_relaxed);
+        while ((int64_t)live > 0 && live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+        }
+    }
+
+    void flush(size_t tag) {
+        apply(tagCounters[tag], pending.bytes[tag], pending.allocations[tag], pending.frees[tag]);
+        apply(totalCounters, pending.bytes[tag], pending.allocations[tag], pending.frees[tag]);
+        pending.bytes[tag] = 0;
+        pending.allocations[tag] = 0;
+        pending.frees[tag] = 0;
+        pending.operations[tag] = 0;
+    }
+
+    Pending::~Pending() {
+        for (size_t i = 0; i < MemoryAccounting::TAG_COUNT; i++) {
+            flush(i);
+        }
+    }
+
+    void record(size_t tag, int64_t bytes, bool allocation) {
+        pending.bytes[tag] += bytes;
+        if (allocation) {
+            pending.allocations[tag]++;
+        } else {
+            pending.frees[tag]++;
+        }
+        if (++pending.operations[tag] >= FLUSH_OPERATIONS || pending.bytes[tag] >= FLUSH_BYTES || pending.bytes[tag] <= -FLUSH_BYTES) {
+            flush(tag);
+        }
+    }
+
+    MemoryAccounting::Usage readCounters(const Counters& counters) {
+        MemoryAccounting::Usage usage;
+        usage.liveBytes = counters.liveBytes.load(memory_order_relaxed);
+        usage.peakBytes = counters.peakBytes.load(memory_order_relaxed);
+        usage.allocationCount = counters.allocationCount.load(memory_order_relaxed);
+        usage.liveAllocationCount = counters.liveAllocationCount.load(memory_order_relaxed);
+        return usage;
+    }
+
+    string formatBytes(uint64_t bytes) {
+        ostringstream out;
+        out << fixed << setprecision(1);
+        if (bytes >= (1ull << 30)) {
+            out << (double)bytes / (double)(1ull << 30) << " GB";
+        } else if (bytes >= (1ull << 20)) {
+            out << (double)bytes / (double)(1ull << 20) << " MB";
+        } else {
+            out << (double)bytes / 1024.0 << " KB";
+        }
+        return out.str();
+    }
+
+    void* allocateOrThrow(size_t size) {
+        while (true) {
+            void* block = MemoryAccounting::allocate(size);
+            if (block != nullptr) {
+                return block;
+            }
+            new_handler handler = get_new_handler();
+            if (handler == nullptr) {
+                throw bad_alloc();
+            }
+            handler();
+        }
+    }
+}
+
+/**
+ * @brief Get what is charged to a tag
+ *
+ * @return Usage
+ */
+MemoryAccounting::Usage MemoryAccounting::getUsage(MemoryTag tag) {
+    return readCounters(tagCounters[(size_t)tag]);
+}
+
+/**
+ * @brief Get what is charged to every tag together (the peak is of the sum, not the sum of the peaks)
+ *
+ * @return Usage
+ */
+MemoryAccounting::Usage MemoryAccounting::getTotal() {
+    return readCounters(totalCounters);
+}
+
+/**
+ * @brief Get the name of a tag
+ *
+ * @return std::string
+ */
+string MemoryAccounting::getTagName(MemoryTag tag) {
+    return TAG_NAMES[(size_t)tag];
+}
+
+/**
+ * @brief Get the tag new allocations on this thread are charged to
+ *
+ * @return MemoryTag
+ */
+MemoryTag MemoryAccounting::getCurrentTag() {
+    return currentTag;
+}
+
+/**
+ * @brief Get one readable line per tag that has ever allocated, then one for the total
+ *
+ * Only the calling thread's changes are passed on first, other running threads can still hold back theirs.
+ *
+ * @return std::vector<std::string>
+ */
+vector<string> MemoryAccounting::describeUsage() {
+    for (size_t i = 0; i < TAG_COUNT; i++) {
+        flush(i);
+    }
+    vector<string> lines;
+    for (size_t i = 0; i <= TAG_COUNT; i++) {
+        Usage usage = i < TAG_COUNT ? getUsage((MemoryTag)i) : getTotal();
+        if (i < TAG_COUNT && usage.allocationCount == 0) {
+            continue;
+        }
+        ostringstream line;
+        line << (i < TAG_COUNT ? TAG_NAMES[i] : "total") << ": " << formatBytes(usage.liveBytes) << " in " << usage.liveAllocationCount
+             << " blocks, peak " << formatBytes(usage.peakBytes) << ", " << usage.allocationCount << " allocations";
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+/**
+ * @brief Allocate a block charged to the current tag, nullptr if out of memory
+ *
+ * @return void*
+ */
+void* MemoryAccounting::allocate(size_t size) {
+    BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (header == nullptr) {
+        return nullptr;
+    }
+    header->size = size;
+    header->tag = (uint32_t)currentTag;
+    record(header->tag, (int64_t)size, true);
+    return header + 1;
+}
+
+/**
+ * @brief Free a block from allocate, uncharging the tag it was allocated under
+ *
+ */
+void MemoryAccounting::release(void* block) {
+    if (block == nullptr) {
+        return;
+    }
+    BlockHeader* header = (BlockHeader*)block - 1;
+    record(header->tag, -(int64_t)header->size, false);
+    free(header);
+}
+
+/**
+ * @brief Set the tag new allocations on this thread are charged to
+ *
+ */
+void MemoryAccounting::setCurrentTag(MemoryTag tag) {
+    currentTag = tag;
+}
+
+/**
+ * @brief Start charging to the given tag
+ *
+ */
+MemoryScope::MemoryScope(MemoryTag tag) {
+    _previous = MemoryAccounting::getCurrentTag();
+    MemoryAccounting::setCurrentTag(tag);
+}
+
+/**
+ * @brief Go back to the tag that was current before
+ *
+ */
+MemoryScope::~MemoryScope() {
+    MemoryAccounting::setCurrentTag(_previous);
+}
+
+// every plain new and delete in the program goes through the accounting; over-aligned ones keep the library's
+void* operator new(size_t size) {
+    return allocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+    return allocateOrThrow(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return MemoryAccounting::allocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return MemoryAccounting::allocate(size);
+}
+
+void operator delete(void* block) noexcept {
+    MemoryAccounting::release(block);
+}
+
+void operator delete[](void* block) noexcept {
+    MemoryAccounting::release(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    MemoryAccounting::release(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    MemoryAccounting::release(block);
+}
+
+void operator delete(void* block, const nothrow_t&) noexcept {
+    MemoryAccounting::release(block);
+}
+
+void operator delete[](void* block, const nothrow_t&) noexcept {
+    MemoryAccounting::release(block);
+}
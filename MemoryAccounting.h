@@ -0,0 +1,121 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The subsystem a heap allocation is charged to
+ *
+ */
+enum class MemoryTag : uint8_t { Other, Sequences, PairSequences, Codons, Proteins, Loaders, Indexes, Caches, Render };
+
+/**
+ * @brief Counts every heap allocation made through new (the standard containers and strings included)
+ * against the tag of the MemoryScope it was made in, and the free against the same tag wherever it happens
+ *
+ * Tasks run by the TaskScheduler are charged to the tag that was current where they were submitted.
+ * Each thread adds up its changes and passes them on every 16 KB or 256 allocations, and the rest when it exits,
+ * so the counts (and peaks) can lag by that much per running thread and tag; reports are approximate while workers are busy.
+ * Memory the process maps itself (the result cache file) or that libraries get from malloc directly is not counted.
+ */
+class MemoryAccounting {
+    public:
+        static const size_t TAG_COUNT = 9;
+
+        struct Usage {
+            uint64_t liveBytes = 0;
+            uint64_t peakBytes = 0;
+            // every allocation ever made, and those not freed yet
+            uint64_t allocationCount = 0;
+            uint64_t liveAllocationCount = 0;
+        };
+
+        /**
+         * @brief Get what is charged to a tag
+         *
+         * @return Usage
+         */
+        static Usage getUsage(MemoryTag);
+
+        /**
+         * @brief Get what is charged to every tag together (the peak is of the sum, not the sum of the peaks)
+         *
+         * @return Usage
+         */
+        static Usage getTotal();
+
+        /**
+         * @brief Get the name of a tag
+         *
+         * @return std::string
+         */
+        static std::string getTagName(MemoryTag);
+
+        /**
+         * @brief Get the tag new allocations on this thread are charged to
+         *
+         * @return MemoryTag
+         */
+        static MemoryTag getCurrentTag();
+
+        /**
+         * @brief Get one readable line per tag that has ever allocated, then one for the total
+         *
+         * Only the calling thread's changes are passed on first, other running threads can still hold back theirs.
+         *
+         * @return std::vector<std::string>
+         */
+        static std::vector<std::string> describeUsage();
+
+        /**
+         * @brief Allocate a block charged to the current tag, nullptr if out of memory
+         *
+         * @return void*
+         */
+        static void* allocate(size_t);
+
+        /**
+         * @brief Free a block from allocate, uncharging the tag it was allocated under
+         *
+         */
+        static void release(void*);
+
+    private:
+        friend class MemoryScope;
+
+        /**
+         * @brief Set the tag new allocations on this thread are charged to
+         *
+         */
+        static void setCurrentTag(MemoryTag);
+};
+
+/**
+ * @brief Charges the allocations made on this thread to a tag until it goes out of scope
+ *
+ */
+class MemoryScope {
+    public:
+        /**
+         * @brief Start charging to the given tag
+         *
+         */
+        explicit MemoryScope(MemoryTag);
+
+        /**
+         * @brief Go back to the tag that was current before
+         *
+         */
+        ~MemoryScope();
+
+        MemoryScope(const MemoryScope&) = delete;
+        MemoryScope& operator=(const MemoryScope&) = delete;
+
+    private:
+        MemoryTag _previous;
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "MutationSimulator.h"
+#include "Protein.h"
+#include "TaskScheduler.h"
+#include "analysis_kernels.h"
+#include "dna_functions.h"
+#include "sequence_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief splitmix64 generator, cheap enough to seed once per strand and replicate
+     *
+     */
+    struct Random {
+        uint64_t state;
+
+        uint64_t next() {
+            uint64_t value = (state += 0x9E3779B97F4A7C15ULL);
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+            return value ^ (value >> 31);
+        }
+
+        // uniform in (0, 1]
+        double uniform() {
+            return (double)((next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+        }
+    };
+
+    // the amino acid number getAminoAcid gives the stop codons
+    uint8_t stopAminoAcid() {
+        static const uint8_t stop = getAminoAcid(Protein::findCodonIndex("UAA"));
+        return stop;
+    }
+
+    char findTransition(char base) {
+        switch (base) {
+            case 'A': return 'G';
+            case 'G': return 'A';
+            case 'C': return 'T';
+            case 'T': return 'C';
+            default: return 'A';
+        }
+    }
+
+    /**
+     * @brief Pick one of the two transversions of a base
+     *
+     */
+    char findTransversion(char base, bool second) {
+        if (base == 'A' || base == 'G') {
+            return second ? 'T' : 'C';
+        }
+        return second ? 'G' : 'A';
+    }
+
+    // buffers reused by every strand a thread mutates
+    thread_local vector<Mutation> mutationBuffer;
+    thread_local string sequenceBuffer;
+    thread_local vector<uint8_t> mutatedBuffer;
+    thread_local string pairBuffer;
+}
+
+/**
+ * @brief Add another summary to this one
+ *
+ */
+void MutationSimulator::Summary::merge(const Summary& other) {
+    strands += other.strands;
+    bases += other.bases;
+    transitions += other.transitions;
+    transversions += other.transversions;
+    insertions += other.insertions;
+    deletions += other.deletions;
+    synonymous += other.synonymous;
+    nonSynonymous += other.nonSynonymous;
+    nonsense += other.nonsense;
+    proteinSimilarity += other.proteinSimilarity;
+    substitutionOnlySimilarity += other.substitutionOnlySimilarity;
+    substitutionOnlyStrands += other.substitutionOnlyStrands;
+}
+
+/**
+ * @brief Get the number of mutations of every kind
+ *
+ * @return uint64_t
+ */
+uint64_t MutationSimulator::Summary::getMutationCount() const {
+    return transitions + transversions + insertions + deletions;
+}
+
+/**
+ * @brief Get the mean compareProteins of the mutated strands against their originals
+ *
+ * @return double
+ */
+double MutationSimulator::Summary::getMeanProteinSimilarity() const {
+    return strands == 0 ? 0 : proteinSimilarity / (double)strands;
+}
+
+/**
+ * @brief Get the mean compareProteins of the mutated strands that had no indels
+ *
+ * @return double
+ */
+double MutationSimulator::Summary::getMeanSubstitutionOnlySimilarity() const {
+    return substitutionOnlyStrands == 0 ? 0 : substitutionOnlySimilarity / (double)substitutionOnlyStrands;
+}
+
+/**
+ * @brief Construct a simulator with a mutation model and a seed; equal seeds give equal results
+ *
+ */
+MutationSimulator::MutationSimulator(const MutationModel& model, uint64_t seed) {
+    _model = model;
+    _seed = seed;
+}
+
+/**
+ * @brief Draw the mutations of one replicate of a sequence, sorted by position
+ *
+ */
+void MutationSimulator::sampleMutations(string_view sequence, uint64_t strand, uint64_t replicate, vector<Mutation>& mutations) const {
+    mutations.clear();
+    double totalRate = _model.substitutionRate + _model.insertionRate + _model.deletionRate;
+    if (totalRate <= 0 || sequence.empty()) {
+        return;
+    }
+    totalRate = min(totalRate, 1.0);
+
+    // every strand and replicate gets its own stream, so the result doesn't depend on the thread that ran it
+    Random random;
+    random.state = _seed ^ (strand * 0xD1B54A32D192ED03ULL);
+    random.state = random.next() ^ (replicate * 0x8CB92BA72F3D8DD7ULL);
+
+    double transitionShare = _model.transitionRatio / (_model.transitionRatio + 1);
+    double logMiss = log1p(-totalRate);
+    const char bases[4] = {'A', 'C', 'G', 'T'};
+
+    // jump straight from one mutated base to the next with geometric gaps instead of a draw per base
+    size_t position = 0;
+    while (true) {
+        if (totalRate < 1) {
+            double gap = floor(log(random.uniform()) / logMiss);
+            if (gap >= (double)(sequence.length() - position)) {
+                return;
+            }
+            position += (size_t)gap;
+        }
+        if (position >= sequence.length()) {
+            return;
+        }
+
+        Mutation mutation;
+        mutation.position = position;
+        double kind = random.uniform() * totalRate;
+        if (kind <= _model.substitutionRate) {
+            mutation.kind = Mutation::Substitution;
+            char original = sequence[position];
+            if (random.uniform() <= transitionShare) {
+                mutation.nucleotide = findTransition(original);
+            } else {
+                mutation.nucleotide = findTransversion(original, (random.next() & 1) != 0);
+            }
+        } else if (kind <= _model.substitutionRate + _model.insertionRate) {
+            mutation.kind = Mutation::Insertion;
+            mutation.nucleotide = bases[random.next() & 3];
+        } else {
+            mutation.kind = Mutation::Deletion;
+            mutation.nucleotide = sequence[position];
+        }
+        mutations.push_back(mutation);
+        position++;
+    }
+}
+
+/**
+ * @brief Mutate one sequence and summarize the effect of the mutations
+ *
+ * @return Summary
+ */
+MutationSimulator::Summary MutationSimulator::mutateSequence(string_view sequence, uint64_t strand, uint64_t replicate) const {
+    Translation original;
+    translate(sequence, original);
+    return mutate(sequence, original, strand, replicate);
+}
+
+/**
+ * @brief Mutate every available strand of the dataset the given number of times in parallel
+ *
+ * @return Summary
+ */
+MutationSimulator::Summary MutationSimulator::simulate(const Dataset& dataset, size_t replicates) const {
+    vector<uint32_t> rows(dataset.getAvailableCount());
+    for (size_t i = 0; i < rows.size(); i++) {
+        rows[i] = (uint32_t)i;
+    }
+    return simulate(dataset, rows, replicates);
+}
+
+/**
+ * @brief Mutate the given strands of the dataset the given number of times in parallel
+ *
+ * @return Summary
+ */
+MutationSimulator::Summary MutationSimulator::simulate(const Dataset& dataset, const vector<uint32_t>& rows, size_t replicates) const {
+    size_t strands = rows.size();
+    Summary total;
+    mutex totalMutex;
+    TaskScheduler::shared().parallelFor(strands * replicates, 64, [&](size_t start, size_t end) {
+        // replicates of a strand are neighbours, so the original is translated once per strand and chunk
+        Summary local;
+        Translation original;
+        size_t translated = SIZE_MAX;
+        for (size_t k = start; k < end; k++) {
+            size_t strand = rows[k / replicates];
+            string_view sequence = dataset.at(strand).getSequence();
+            if (strand != translated) {
+                translate(sequence, original);
+                translated = strand;
+            }
+            local.merge(mutate(sequence, original, strand, k % replicates));
+        }
+        lock_guard<mutex> lock(totalMutex);
+        total.merge(local);
+    }, TaskScheduler::Priority::Batch);
+    return total;
+}
+
+/**
+ * @brief Mutate one sequence whose amino acids are already known
+ *
+ * @return Summary
+ */
+MutationSimulator::Summary MutationSimulator::mutate(string_view sequence, const Translation& original, uint64_t strand, uint64_t replicate) const {
+    Summary summary;
+    summary.strands = 1;
+    summary.bases = sequence.length();
+
+    sampleMutations(sequence, strand, replicate, mutationBuffer);
+    size_t firstIndel = mutationBuffer.size();
+    for (size_t i = 0; i < mutationBuffer.size(); i++) {
+        const Mutation& mutation = mutationBuffer[i];
+        if (mutation.kind == Mutation::Insertion) {
+            summary.insertions++;
+            firstIndel = min(firstIndel, i);
+            continue;
+        }
+        if (mutation.kind == Mutation::Deletion) {
+            summary.deletions++;
+            firstIndel = min(firstIndel, i);
+            continue;
+        }
+
+        if (mutation.nucleotide == findTransition(sequence[mutation.position])) {
+            summary.transitions++;
+        } else {
+            summary.transversions++;
+        }
+
+        // judge each substitution alone against its codon in the original reading frame
+        size_t codonStart = mutation.position - mutation.position % 3;
+        if (codonStart + 3 > sequence.length()) {
+            continue;
+        }
+        char codon[3] = {sequence[codonStart], sequence[codonStart + 1], sequence[codonStart + 2]};
+        uint8_t before = findAminoAcid(codon[0], codon[1], codon[2]);
+        codon[mutation.position % 3] = mutation.nucleotide;
+        uint8_t after = findAminoAcid(codon[0], codon[1], codon[2]);
+        if (before == UNKNOWN_AMINO_ACID || after == UNKNOWN_AMINO_ACID) {
+            continue;
+        }
+        if (before == after) {
+            summary.synonymous++;
+        } else {
+            summary.nonSynonymous++;
+            summary.nonsense += after == stopAminoAcid();
+        }
+    }
+
+    // codons ahead of the first indel keep their frame, so only the ones holding a substitution can stop matching
+    size_t codonCount = original.aminoAcids.size();
+    size_t tailCodon = firstIndel < mutationBuffer.size() ? mutationBuffer[firstIndel].position / 3 : codonCount;
+    size_t matches = original.readableBefore[tailCodon];
+    size_t i = 0;
+    while (i < mutationBuffer.size() && mutationBuffer[i].position / 3 < tailCodon) {
+        size_t codonIndex = mutationBuffer[i].position / 3;
+        size_t codonStart = codonIndex * 3;
+        char codon[3] = {'?', '?', '?'};
+        for (size_t j = 0; j < 3 && codonStart + j < sequence.length(); j++) {
+            codon[j] = sequence[codonStart + j];
+        }
+        for (; i < mutationBuffer.size() && mutationBuffer[i].position / 3 == codonIndex; i++) {
+            codon[mutationBuffer[i].position % 3] = mutationBuffer[i].nucleotide;
+        }
+        uint8_t before = original.aminoAcids[codonIndex];
+        if (before != UNKNOWN_AMINO_ACID && findAminoAcid(codon[0], codon[1], codon[2]) != before) {
+            matches--;
+        }
+    }
+
+    // from the first indel on the frame shifts, so that part is rebuilt and translated in one pass
+    size_t mutatedLength = sequence.length() + summary.insertions - summary.deletions;
+    size_t mutatedCodons = (mutatedLength + 2) / 3;
+    if (tailCodon < codonCount) {
+        DNAStrand::applyMutations(sequence, mutationBuffer, sequenceBuffer);
+        translateFrom(sequenceBuffer, tailCodon, mutatedBuffer);
+        size_t end = min(codonCount, mutatedCodons);
+        for (size_t k = tailCodon; k < end; k++) {
+            matches += original.aminoAcids[k] != UNKNOWN_AMINO_ACID && mutatedBuffer[k - tailCodon] == original.aminoAcids[k];
+        }
+    }
+
+    // same as compareProteins of the original and mutated strands
+    size_t compared = min(codonCount, mutatedCodons);
+    double similarity = compared == 0 ? 0 : (double)matches / (double)compared * 100;
+    summary.proteinSimilarity = similarity;
+    if (firstIndel == mutationBuffer.size()) {
+        summary.substitutionOnlySimilarity = similarity;
+        summary.substitutionOnlyStrands = 1;
+    }
+    return summary;
+}
+
+/**
+ * @brief Write the amino acid of every codon of a sequence (UNKNOWN_AMINO_ACID where findProtein gives "?")
+ * and how many readable codons come before each codon
+ *
+ */
+void MutationSimulator::translate(string_view sequence, Translation& out) {
+    translateFrom(sequence, 0, out.aminoAcids);
+    out.readableBefore.resize(out.aminoAcids.size() + 1);
+    out.readableBefore[0] = 0;
+    for (size_t i = 0; i < out.aminoAcids.size(); i++) {
+        out.readableBefore[i + 1] = out.readableBefore[i] + (out.aminoAcids[i] != UNKNOWN_AMINO_ACID);
+    }
+}
+
+/**
+ * @brief Write the amino acid of every codon of a sequence from the given codon on (UNKNOWN_AMINO_ACID where
+ * findProtein gives "?")
+ *
+ */
+void MutationSimulator::translateFrom(string_view sequence, size_t firstCodon, vector<uint8_t>& out) {
+    // codons are read from the pair sequence, like those of a DNAStrand, and a trailing partial codon is kept
+    size_t start = firstCodon * CODON_LENGTH;
+    size_t length = sequence.length() > start ? sequence.length() - start : 0;
+    pairBuffer.resize(length);
+    transcribeSequence(sequence.data() + start, &pairBuffer[0], length);
+    out.resize((length + CODON_LENGTH - 1) / CODON_LENGTH);
+    translateCodons<Alphabet::RNA>(pairBuffer.data(), length, out.data());
+}
+
+/**
+ * @brief Get the amino acid of three DNA bases read through their pairs, UNKNOWN_AMINO_ACID if a base is
+ * not A, C, G or T
+ *
+ * @return uint8_t
+ */
+uint8_t MutationSimulator::findAminoAcid(char first, char second, char third) {
+    const char pairs[CODON_LENGTH] = {getPair(first), getPair(second), getPair(third)};
+    uint8_t codon;
+    findCodons<Alphabet::RNA>(pairs, CODON_LENGTH, &codon);
+    return getAminoAcid(codon);
+}
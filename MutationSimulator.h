@@ -0,0 +1,150 @@
+#ifndef MUTATIONSIMULATOR_H
+#define MUTATIONSIMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Dataset.h"
+#include "DNAStrand.h"
+
+/**
+ * @brief Per base rates of the random mutations applied to each strand
+ *
+ */
+struct MutationModel {
+    double substitutionRate = 0.001;
+    // transitions (A <-> G, C <-> T) per transversion
+    double transitionRatio = 2.0;
+    double insertionRate = 0.0001;
+    double deletionRate = 0.0001;
+};
+
+/**
+ * @brief Applies seeded random SNPs and indels to whole datasets and measures how the synonymous and
+ * non-synonymous changes move compareProteins, working on plain sequences so each replicate costs
+ * one pass per strand
+ *
+ */
+class MutationSimulator {
+    public:
+        struct Summary {
+            uint64_t strands = 0;
+            uint64_t bases = 0;
+            uint64_t transitions = 0;
+            uint64_t transversions = 0;
+            uint64_t insertions = 0;
+            uint64_t deletions = 0;
+            // substitutions by their effect on the amino acid of their original codon
+            uint64_t synonymous = 0;
+            uint64_t nonSynonymous = 0;
+            // non-synonymous substitutions that create a stop codon
+            uint64_t nonsense = 0;
+            // sum over the mutated strands of compareProteins against the original
+            double proteinSimilarity = 0;
+            // the same sum over the strands without indels, where only substitutions count
+            double substitutionOnlySimilarity = 0;
+            uint64_t substitutionOnlyStrands = 0;
+
+            /**
+             * @brief Add another summary to this one
+             *
+             */
+            void merge(const Summary&);
+
+            /**
+             * @brief Get the number of mutations of every kind
+             *
+             * @return uint64_t
+             */
+            uint64_t getMutationCount() const;
+
+            /**
+             * @brief Get the mean compareProteins of the mutated strands against their originals
+             *
+             * @return double
+             */
+            double getMeanProteinSimilarity() const;
+
+            /**
+             * @brief Get the mean compareProteins of the mutated strands that had no indels
+             *
+             * @return double
+             */
+            double getMeanSubstitutionOnlySimilarity() const;
+        };
+
+        /**
+         * @brief Construct a simulator with a mutation model and a seed; equal seeds give equal results
+         *
+         */
+        MutationSimulator(const MutationModel&, uint64_t);
+
+        /**
+         * @brief Draw the mutations of one replicate of a sequence, sorted by position
+         *
+         */
+        void sampleMutations(std::string_view, uint64_t, uint64_t, std::vector<Mutation>&) const;
+
+        /**
+         * @brief Mutate one sequence and summarize the effect of the mutations
+         *
+         * @return Summary
+         */
+        Summary mutateSequence(std::string_view, uint64_t, uint64_t) const;
+
+        /**
+         * @brief Mutate every available strand of the dataset the given number of times in parallel
+         *
+         * @return Summary
+         */
+        Summary simulate(const Dataset&, size_t) const;
+
+        /**
+         * @brief Mutate the given strands of the dataset the given number of times in parallel
+         *
+         * @return Summary
+         */
+        Summary simulate(const Dataset&, const std::vector<uint32_t>&, size_t) const;
+
+    private:
+        struct Translation {
+            std::vector<uint8_t> aminoAcids;
+            std::vector<uint32_t> readableBefore;
+        };
+
+        /**
+         * @brief Mutate one sequence whose amino acids are already known
+         *
+         * @return Summary
+         */
+        Summary mutate(std::string_view, const Translation&, uint64_t, uint64_t) const;
+
+        /**
+         * @brief Write the amino acid of every codon of a sequence (UNKNOWN_AMINO_ACID where findProtein gives "?")
+         * and how many readable codons come before each codon
+         *
+         */
+        static void translate(std::string_view, Translation&);
+
+        /**
+         * @brief Write the amino acid of every codon of a sequence from the given codon on (UNKNOWN_AMINO_ACID where
+         * findProtein gives "?")
+         *
+         */
+        static void translateFrom(std::string_view, size_t, std::vector<uint8_t>&);
+
+        /**
+         * @brief Get the amino acid of three DNA bases read through their pairs, UNKNOWN_AMINO_ACID if a base is
+         * not A, C, G or T
+         *
+         * @return uint8_t
+         */
+        static uint8_t findAminoAcid(char, char, char);
+
+        MutationModel _model;
+        uint64_t _seed;
+};
+
+#endif
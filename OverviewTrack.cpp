@@ -0,0 +1,419 @@
+#include "OverviewTrack.h"
+#include "Dataset.h"
+#include "DNAStrand.h"
+#include "TaskScheduler.h"
+#include <SFML/Graphics.hpp>
+#include <future>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const size_t MIN_VIEW_SPAN = 16;
+
+    float isGC(char nucleotide) {
+        return nucleotide == 'G' || nucleotide == 'C' ? 1.f : 0.f;
+    }
+
+    float gcFraction(string_view sequence) {
+        if (sequence.empty()) {
+            return 0;
+        }
+        size_t gc = 0;
+        for (size_t i = 0; i < sequence.size(); i++) {
+            gc += sequence[i] == 'G' || sequence[i] == 'C';
+        }
+        return (float)gc / (float)sequence.size();
+    }
+
+    sf::Color shade(sf::Color low, sf::Color high, float amount) {
+        return sf::Color((uint8_t)((float)low.r + ((float)high.r - (float)low.r) * amount),
+                         (uint8_t)((float)low.g + ((float)high.g - (float)low.g) * amount),
+                         (uint8_t)((float)low.b + ((float)high.b - (float)low.b) * amount));
+    }
+}
+
+/**
+ * @brief Construct an empty OverviewTrack
+ *
+ */
+OverviewTrack::OverviewTrack() {
+    _length = 0;
+    _viewStart = 0;
+    _viewSpan = 0;
+    _width = 0;
+    _textureDirty = true;
+}
+
+/**
+ * @brief Cancel any background build and wait for it to let go of its strands
+ *
+ */
+OverviewTrack::~OverviewTrack() {
+    cancelBuild();
+    for (size_t i = 0; i < _cancelled.size(); i++) {
+        _cancelled[i].wait();
+    }
+}
+
+/**
+ * @brief Sample a pair of strands one base at a time
+ *
+ * @return Samples
+ */
+OverviewTrack::Samples OverviewTrack::sampleStrands(const DNAStrand& first, const DNAStrand& second) {
+    string_view firstSequence = first.getSequence();
+    string_view secondSequence = second.getSequence();
+    size_t end = firstSequence.size();
+    if (secondSequence.size() > end) {
+        end = secondSequence.size();
+    }
+
+    // positions past the end of the shorter strand count as mismatches
+    Samples samples;
+    samples.similarity.assign(end, 0);
+    samples.firstGC.assign(end, 0);
+    samples.secondGC.assign(end, 0);
+    for (size_t i = 0; i < firstSequence.size(); i++) {
+        samples.firstGC[i] = isGC(firstSequence[i]);
+    }
+    for (size_t i = 0; i < secondSequence.size(); i++) {
+        samples.secondGC[i] = isGC(secondSequence[i]);
+        if (i < firstSequence.size() && firstSequence[i] == secondSequence[i]) {
+            samples.similarity[i] = 1;
+        }
+    }
+    return samples;
+}
+
+/**
+ * @brief Sample a pair of datasets one strand at a time
+ *
+ * @return Samples
+ */
+OverviewTrack::Samples OverviewTrack::sampleDataset(const Dataset& first, const Dataset& second) {
+    size_t end = first.getAvailableCount();
+    if (second.getAvailableCount() < end) {
+        end = second.getAvailableCount();
+    }
+
+    Samples samples;
+    samples.similarity.resize(end);
+    samples.firstGC.resize(end);
+    samples.secondGC.resize(end);
+    TaskScheduler::shared().parallelFor(end, 64, [&](size_t start, size_t stop) {
+        for (size_t i = start; i < stop; i++) {
+            string_view firstSequence = first.at(i).getSequence();
+            string_view secondSequence = second.at(i).getSequence();
+            size_t shared = firstSequence.size() < secondSequence.size() ? firstSequence.size() : secondSequence.size();
+            size_t matches = 0;
+            for (size_t j = 0; j < shared; j++) {
+                matches += firstSequence[j] == secondSequence[j];
+            }
+
+            samples.similarity[i] = shared == 0 ? 0 : (float)matches / (float)shared;
+            samples.firstGC[i] = gcFraction(firstSequence);
+            samples.secondGC[i] = gcFraction(secondSequence);
+        }
+    }, TaskScheduler::Priority::Batch);
+    return samples;
+}
+
+/**
+ * @brief Build the pyramid from the given samples and reset the view to the whole track
+ *
+ */
+void OverviewTrack::build(const Samples& samples) {
+    cancelBuild();
+    setLevels(buildLevels(samples));
+}
+
+/**
+ * @brief Run the sampler and pyramid build on the shared scheduler, replacing the track once done;
+ * a build still in flight is cancelled
+ *
+ */
+void OverviewTrack::buildAsync(function<Samples()> sampler, TaskScheduler::Priority priority) {
+    cancelBuild();
+    setLevels({});
+    _buildToken = CancelToken();
+    _pending = TaskScheduler::shared().async([sampler]() {
+        return buildLevels(sampler());
+    }, priority, _buildToken);
+}
+
+/**
+ * @brief Check whether a built pyramid is available to draw
+ *
+ * @return bool
+ */
+bool OverviewTrack::isReady() {
+    collectBuild();
+    return !_levels.empty();
+}
+
+/**
+ * @brief Check whether a build is still running, collecting it if it just finished
+ *
+ * @return bool
+ */
+bool OverviewTrack::isBuilding() {
+    collectBuild();
+    return _pending.valid();
+}
+
+/**
+ * @brief Get the number of samples covered by the track
+ *
+ * @return size_t
+ */
+size_t OverviewTrack::getLength() const {
+    return _length;
+}
+
+/**
+ * @brief Halve the visible span around the given sample
+ *
+ */
+void OverviewTrack::zoomIn(size_t center) {
+    size_t minSpan = _length < MIN_VIEW_SPAN ? _length : MIN_VIEW_SPAN;
+    _viewSpan = _viewSpan / 2 < minSpan ? minSpan : _viewSpan / 2;
+    _viewStart = center > _viewSpan / 2 ? center - _viewSpan / 2 : 0;
+    clampView();
+}
+
+/**
+ * @brief Double the visible span around the given sample
+ *
+ */
+void OverviewTrack::zoomOut(size_t center) {
+    _viewSpan = _viewSpan * 2 > _length ? _length : _viewSpan * 2;
+    _viewStart = center > _viewSpan / 2 ? center - _viewSpan / 2 : 0;
+    clampView();
+}
+
+/**
+ * @brief Find the sample under the given x coordinate of the track
+ *
+ * @return size_t
+ */
+size_t OverviewTrack::findPosition(float x) const {
+    if (_length == 0 || _width == 0) {
+        return 0;
+    }
+
+    float relative = x - _position.x;
+    if (relative < 0) {
+        relative = 0;
+    }
+    size_t position = _viewStart + (size_t)(relative * (float)_viewSpan / (float)_width);
+    return position < _length ? position : _length - 1;
+}
+
+/**
+ * @brief Check whether a point in the window lies on the drawn track
+ *
+ * @return bool
+ */
+bool OverviewTrack::contains(sf::Vector2f point) const {
+    return point.x >= _position.x && point.x < _position.x + (float)_width &&
+           point.y >= _position.y && point.y < _position.y + (float)(3 * ROW_HEIGHT);
+}
+
+/**
+ * @brief Draw the track and outline the samples [markerStart, markerStart + markerSpan)
+ *
+ */
+void OverviewTrack::draw(sf::RenderWindow& rw, sf::Vector2f startPosition, size_t markerStart, size_t markerSpan) {
+    collectBuild();
+
+    unsigned width = rw.getSize().x - 2 * (unsigned)startPosition.x;
+    _position = startPosition;
+    if (_levels.empty()) {
+        _width = width;
+        sf::RectangleShape placeholder(sf::Vector2f((float)width, (float)(3 * ROW_HEIGHT)));
+        placeholder.setFillColor(sf::Color(40, 40, 40));
+        placeholder.setPosition(startPosition);
+        rw.draw(placeholder);
+        return;
+    }
+
+    if (_textureDirty || width != _width) {
+        renderTexture(width);
+    }
+    sf::Sprite sprite(_texture);
+    sprite.setPosition(startPosition);
+    rw.draw(sprite);
+
+    // outline the part of the track shown in the main view
+    size_t markerEnd = markerStart + markerSpan;
+    if (markerEnd > _viewStart && markerStart < _viewStart + _viewSpan) {
+        size_t left = markerStart > _viewStart ? markerStart - _viewStart : 0;
+        size_t right = markerEnd - _viewStart < _viewSpan ? markerEnd - _viewStart : _viewSpan;
+        float scale = (float)_width / (float)_viewSpan;
+
+        sf::RectangleShape marker;
+        marker.setSize(sf::Vector2f((float)(right - left) * scale, (float)(3 * ROW_HEIGHT)));
+        marker.setPosition(sf::Vector2f(startPosition.x + (float)left * scale, startPosition.y));
+        marker.setFillColor(sf::Color::Transparent);
+        marker.setOutlineColor(sf::Color::White);
+        marker.setOutlineThickness(1);
+        rw.draw(marker);
+    }
+}
+
+/**
+ * @brief Sum the samples pairwise into successively coarser levels
+ *
+ * @return std::vector<Level>
+ */
+vector<OverviewTrack::Level> OverviewTrack::buildLevels(const Samples& samples) {
+    vector<Level> levels;
+    if (samples.similarity.empty()) {
+        return levels;
+    }
+
+    levels.push_back({samples.similarity, samples.firstGC, samples.secondGC});
+    while (levels.back().similarity.size() > 1) {
+        const Level& finer = levels.back();
+        size_t size = (finer.similarity.size() + 1) / 2;
+
+        Level coarser;
+        coarser.similarity.resize(size);
+        coarser.firstGC.resize(size);
+        coarser.secondGC.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            size_t left = 2 * i;
+            size_t right = left + 1 < finer.similarity.size() ? left + 1 : left;
+            bool paired = right != left;
+            coarser.similarity[i] = finer.similarity[left] + (paired ? finer.similarity[right] : 0);
+            coarser.firstGC[i] = finer.firstGC[left] + (paired ? finer.firstGC[right] : 0);
+            coarser.secondGC[i] = finer.secondGC[left] + (paired ? finer.secondGC[right] : 0);
+        }
+        levels.push_back(move(coarser));
+    }
+    return levels;
+}
+
+/**
+ * @brief Install a finished pyramid and reset the view to the whole track
+ *
+ */
+void OverviewTrack::setLevels(vector<Level> levels) {
+    _levels = move(levels);
+    _length = _levels.empty() ? 0 : _levels.front().similarity.size();
+    _viewStart = 0;
+    _viewSpan = _length;
+    _textureDirty = true;
+}
+
+/**
+ * @brief Cancel the build in flight (if any) without waiting for it, keeping it aside until it is
+ * dropped or finished
+ *
+ */
+void OverviewTrack::cancelBuild() {
+    _buildToken.cancel();
+    // a sampler that already started runs to the end, possibly a whole dataset at batch priority,
+    // so the caller (the viewer) must not wait for it
+    for (size_t i = 0; i < _cancelled.size();) {
+        if (_cancelled[i].wait_for(chrono::seconds(0)) == future_status::ready) {
+            _cancelled.erase(_cancelled.begin() + (ptrdiff_t)i);
+        } else {
+            i++;
+        }
+    }
+    if (_pending.valid()) {
+        _cancelled.push_back(move(_pending));
+        _pending = future<vector<Level>>();
+    }
+}
+
+/**
+ * @brief Take over a finished background build if one is waiting
+ *
+ */
+void OverviewTrack::collectBuild() {
+    if (_pending.valid() && _pending.wait_for(chrono::seconds(0)) == future_status::ready) {
+        try {
+            setLevels(_pending.get());
+        } catch (const future_error&) {
+            // the build was cancelled before it ran
+        }
+    }
+}
+
+/**
+ * @brief Redraw the texture from the pyramid level that best matches the current view
+ *
+ */
+void OverviewTrack::renderTexture(unsigned width) {
+    _width = width;
+    _textureDirty = false;
+    if (width == 0 || _levels.empty()) {
+        return;
+    }
+
+    // pick the coarsest level whose bins are no wider than one pixel
+    size_t level = 0;
+    while (level + 1 < _levels.size() && ((size_t)2 << level) * width <= _viewSpan) {
+        level++;
+    }
+    const Level& bins = _levels.at(level);
+
+    sf::Image image(sf::Vector2u(width, 3 * ROW_HEIGHT));
+    for (unsigned x = 0; x < width; x++) {
+        size_t start = _viewStart + (size_t)x * _viewSpan / width;
+        size_t end = _viewStart + (size_t)(x + 1) * _viewSpan / width;
+        if (end <= start) {
+            end = start + 1;
+        }
+
+        // sum the bins touching this pixel and average over the samples they cover
+        size_t firstBin = start >> level;
+        size_t lastBin = (end - 1) >> level;
+        float similarity = 0;
+        float firstGC = 0;
+        float secondGC = 0;
+        for (size_t i = firstBin; i <= lastBin && i < bins.similarity.size(); i++) {
+            similarity += bins.similarity[i];
+            firstGC += bins.firstGC[i];
+            secondGC += bins.secondGC[i];
+        }
+        size_t coveredEnd = (lastBin + 1) << level;
+        if (coveredEnd > _length) {
+            coveredEnd = _length;
+        }
+        float covered = (float)(coveredEnd - (firstBin << level));
+
+        sf::Color similarityColor = shade(sf::Color::Red, sf::Color::Green, similarity / covered);
+        sf::Color firstColor = shade(sf::Color::Black, sf::Color::Cyan, firstGC / covered);
+        sf::Color secondColor = shade(sf::Color::Black, sf::Color::Cyan, secondGC / covered);
+        for (unsigned y = 0; y < ROW_HEIGHT; y++) {
+            image.setPixel(sf::Vector2u(x, y), firstColor);
+            image.setPixel(sf::Vector2u(x, ROW_HEIGHT + y), similarityColor);
+            image.setPixel(sf::Vector2u(x, 2 * ROW_HEIGHT + y), secondColor);
+        }
+    }
+
+    if (!_texture.loadFromImage(image)) {
+        _textureDirty = true;
+    }
+}
+
+/**
+ * @brief Keep the view inside the track
+ *
+ */
+void OverviewTrack::clampView() {
+    if (_viewSpan > _length) {
+        _viewSpan = _length;
+    }
+    if (_viewStart + _viewSpan > _length) {
+        _viewStart = _length - _viewSpan;
+    }
+    _textureDirty = true;
+}
@@ -0,0 +1,185 @@
+#ifndef OVERVIEWTRACK_H
+#define OVERVIEWTRACK_H
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <vector>
+#include "Dataset.h"
+#include "DNAStrand.h"
+#include "TaskScheduler.h"
+#include <SFML/Graphics.hpp>
+
+class OverviewTrack {
+    public:
+        /**
+         * @brief Per sample similarity and GC content (each from 0 to 1) that the pyramid is built from
+         *
+         */
+        struct Samples {
+            std::vector<float> similarity;
+            std::vector<float> firstGC;
+            std::vector<float> secondGC;
+        };
+
+        /**
+         * @brief Construct an empty OverviewTrack
+         *
+         */
+        OverviewTrack();
+
+        /**
+         * @brief Cancel any background build and wait for it to let go of its strands
+         *
+         */
+        ~OverviewTrack();
+
+        OverviewTrack(const OverviewTrack&) = delete;
+        OverviewTrack& operator=(const OverviewTrack&) = delete;
+
+        /**
+         * @brief Sample a pair of strands one base at a time
+         *
+         * @return Samples
+         */
+        static Samples sampleStrands(const DNAStrand&, const DNAStrand&);
+
+        /**
+         * @brief Sample a pair of datasets one strand at a time
+         *
+         * @return Samples
+         */
+        static Samples sampleDataset(const Dataset&, const Dataset&);
+
+        /**
+         * @brief Build the pyramid from the given samples and reset the view to the whole track
+         *
+         */
+        void build(const Samples&);
+
+        /**
+         * @brief Run the sampler and pyramid build on the shared scheduler, replacing the track once done;
+         * a build still in flight is cancelled
+         *
+         */
+        void buildAsync(std::function<Samples()>, TaskScheduler::Priority);
+
+        /**
+         * @brief Check whether a built pyramid is available to draw
+         *
+         * @return bool
+         */
+        bool isReady();
+
+        /**
+         * @brief Check whether a build is still running, collecting it if it just finished
+         *
+         * @return bool
+         */
+        bool isBuilding();
+
+        /**
+         * @brief Get the number of samples covered by the track
+         *
+         * @return size_t
+         */
+        size_t getLength() const;
+
+        /**
+         * @brief Halve the visible span around the given sample
+         *
+         */
+        void zoomIn(size_t);
+
+        /**
+         * @brief Double the visible span around the given sample
+         *
+         */
+        void zoomOut(size_t);
+
+        /**
+         * @brief Find the sample under the given x coordinate of the track
+         *
+         * @return size_t
+         */
+        size_t findPosition(float) const;
+
+        /**
+         * @brief Check whether a point in the window lies on the drawn track
+         *
+         * @return bool
+         */
+        bool contains(sf::Vector2f) const;
+
+        /**
+         * @brief Draw the track and outline the samples [markerStart, markerStart + markerSpan)
+         *
+         */
+        void draw(sf::RenderWindow&, sf::Vector2f, size_t, size_t);
+
+    private:
+        /**
+         * @brief Sums of 2^level consecutive samples
+         *
+         */
+        struct Level {
+            std::vector<float> similarity;
+            std::vector<float> firstGC;
+            std::vector<float> secondGC;
+        };
+
+        static const unsigned ROW_HEIGHT = 8;
+
+        /**
+         * @brief Sum the samples pairwise into successively coarser levels
+         *
+         * @return std::vector<Level>
+         */
+        static std::vector<Level> buildLevels(const Samples&);
+
+        /**
+         * @brief Install a finished pyramid and reset the view to the whole track
+         *
+         */
+        void setLevels(std::vector<Level>);
+
+        /**
+         * @brief Cancel the build in flight (if any) without waiting for it, keeping it aside until it is
+         * dropped or finished
+         *
+         */
+        void cancelBuild();
+
+        /**
+         * @brief Take over a finished background build if one is waiting
+         *
+         */
+        void collectBuild();
+
+        /**
+         * @brief Redraw the texture from the pyramid level that best matches the current view
+         *
+         */
+        void renderTexture(unsigned);
+
+        /**
+         * @brief Keep the view inside the track
+         *
+         */
+        void clampView();
+
+        std::vector<Level> _levels;
+        size_t _length;
+        size_t _viewStart;
+        size_t _viewSpan;
+        sf::Vector2f _position;
+        unsigned _width;
+        bool _textureDirty;
+        sf::Texture _texture;
+        std::future<std::vector<Level>> _pending;
+        CancelToken _buildToken;
+        // cancelled builds that may still be running their sampler, waited for only when the track goes
+        std::vector<std::future<std::vector<Level>>> _cancelled;
+};
+
+#endif
@@ -33,13 +33,11 @@ Protein::Protein(string speciesName, string codon) {
  * @return std::string 
  */
 string Protein::findProtein() const {
-    for (size_t i = 0; i < CODONS.size(); i++) {
-        if (_codon == CODONS.at(i)) {
-            return PROTEIN_NAMES.at(i);
-        }
+    int index = findCodonIndex(_codon);
+    if (index < 0) {
+        return "?";
     }
-
-    return "?";
+    return PROTEIN_NAMES.at(index);
 }
 
 /**
@@ -58,4 +56,46 @@ string Protein::getSourceSpecies() const {
  */
 string Protein::getCodon() const {
     return _codon;
+}
+
+/**
+ * @brief Get the index of an RNA codon in the codon table (U, C, A, G order)
+ * 
+ * @return int index from 0 to 63, or -1 if the codon is not in the table
+ */
+int Protein::findCodonIndex(const string& codon) {
+    if (codon.length() != 3) {
+        return -1;
+    }
+    int index = 0;
+    for (size_t i = 0; i < 3; i++) {
+        int base;
+        switch (codon[i]) {
+            case 'U': base = 0; break;
+            case 'C': base = 1; break;
+            case 'A': base = 2; break;
+            case 'G': base = 3; break;
+            default: return -1;
+        }
+        index = index * 4 + base;
+    }
+    return index;
+}
+
+/**
+ * @brief Get the protein name of the codon at the given index of the codon table
+ * 
+ * @return std::string 
+ */
+string Protein::getProteinName(int index) {
+    return PROTEIN_NAMES.at(index);
+}
+
+/**
+ * @brief Get the codon at the given index of the codon table
+ * 
+ * @return std::string 
+ */
+string Protein::getCodonName(int index) {
+    return CODONS.at(index);
 }
\ No newline at end of file
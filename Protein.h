@@ -39,6 +39,27 @@ class Protein {
          */
         std::string getCodon() const;
 
+        /**
+         * @brief Get the index of an RNA codon in the codon table (U, C, A, G order)
+         * 
+         * @return int index from 0 to 63, or -1 if the codon is not in the table
+         */
+        static int findCodonIndex(const std::string&);
+
+        /**
+         * @brief Get the protein name of the codon at the given index of the codon table
+         * 
+         * @return std::string 
+         */
+        static std::string getProteinName(int);
+
+        /**
+         * @brief Get the codon at the given index of the codon table
+         * 
+         * @return std::string 
+         */
+        static std::string getCodonName(int);
+
     private:
         std::string _sourceSpecies;
         std::string _codon;
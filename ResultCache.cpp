@@ -0,0 +1,542 @@
+#include "ResultCache.h"
+#include "dna_functions.h"
+#include "MemoryAccounting.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RESULT_CACHE_MMAP
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#error "ResultCache needs POSIX or Windows file calls to replace its file safely"
+#endif
+
+using namespace std;
+
+namespace {
+    const char FILE_MAGIC[8] = {'D', 'N', 'A', 'R', 'E', 'S', '0', '1'};
+    const uint32_t RECORD_MARKER = 0x31435244;
+}
+
+bool ResultKey::operator==(const ResultKey& other) const {
+    return firstHash == other.firstHash && secondHash == other.secondHash && firstLength == other.firstLength
+        && secondLength == other.secondLength && kind == other.kind && parameters == other.parameters;
+}
+
+size_t ResultCache::KeyHash::operator()(const ResultKey& key) const {
+    return (size_t)(key.firstHash ^ (key.secondHash * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)key.kind << 32 | key.parameters));
+}
+
+/**
+ * @brief Construct a closed ResultCache
+ *
+ */
+ResultCache::ResultCache() {
+    _mapped = nullptr;
+    _mappedSize = 0;
+    _liveBytes = 0;
+    _fileBytes = 0;
+    _log = nullptr;
+    _hitCount = 0;
+    _missCount = 0;
+}
+
+/**
+ * @brief Flush and close the cache file
+ *
+ */
+ResultCache::~ResultCache() {
+    if (_log != nullptr) {
+        fclose(_log);
+    }
+    unmap();
+}
+
+/**
+ * @brief Open the cache file (creating it if it is missing), mapping it into memory and indexing its records;
+ * an existing file that is not a cache is left alone and not opened
+ *
+ * @return bool whether the file could be opened
+ */
+bool ResultCache::open(const string& path) {
+    MemoryScope scope(MemoryTag::Caches);
+    lock_guard<mutex> lock(_mutex);
+    if (_log != nullptr) {
+        fclose(_log);
+        _log = nullptr;
+    }
+    _path = path;
+    _appended.clear();
+    unmap();
+    _index.clear();
+
+    // appending creates a missing file but never changes an existing one, so a path that is not a cache is left as it was
+    _log = fopen(_path.c_str(), "ab");
+    if (_log == nullptr) {
+        return false;
+    }
+    if (!lockFile()) {
+        fclose(_log);
+        _log = nullptr;
+        return false;
+    }
+
+    // other processes only write under the lock, so what is read here is complete
+    size_t validBytes = load();
+    bool opened = true;
+    if (validBytes == 0) {
+        // start over only in a new file, or one cut off while its header was written;
+        // anything else at the path is not a cache
+        error_code error;
+        uintmax_t size = filesystem::file_size(_path, error);
+        bool partial = !error && size < sizeof(FILE_MAGIC) && size == _mappedSize
+            && (size == 0 || memcmp(_mapped, FILE_MAGIC, (size_t)size) == 0);
+        unmap();
+        _index.clear();
+        opened = partial && truncateFile(0) && fwrite(FILE_MAGIC, 1, sizeof(FILE_MAGIC), _log) == sizeof(FILE_MAGIC)
+            && fflush(_log) == 0;
+        _fileBytes = sizeof(FILE_MAGIC);
+        _liveBytes = sizeof(FILE_MAGIC);
+    } else if (validBytes < _fileBytes) {
+        // drop a torn tail from a crash, so later records are not appended behind it
+        opened = truncateFile(validBytes);
+        _fileBytes = validBytes;
+    }
+    if (opened && _fileBytes > 2 * _liveBytes) {
+        // superseded records outweigh the live ones; if the file can't be replaced the old one is kept
+        compactFile();
+        opened = _log != nullptr;
+    }
+    unlockFile();
+
+    if (!opened) {
+        if (_log != nullptr) {
+            fclose(_log);
+        }
+        _log = nullptr;
+        unmap();
+        _index.clear();
+    }
+    return opened;
+}
+
+/**
+ * @brief Check whether a file is open
+ *
+ * @return bool
+ */
+bool ResultCache::isOpen() const {
+    lock_guard<mutex> lock(_mutex);
+    return _log != nullptr;
+}
+
+/**
+ * @brief Find a stored number
+ *
+ * @return bool whether the key was found
+ */
+bool ResultCache::find(const ResultKey& key, double& value) const {
+    vector<uint8_t> payload;
+    if (!findPayload(key, payload) || payload.size() != sizeof(double)) {
+        return false;
+    }
+    memcpy(&value, payload.data(), sizeof(double));
+    return true;
+}
+
+/**
+ * @brief Find a stored list of numbers
+ *
+ * @return bool whether the key was found
+ */
+bool ResultCache::find(const ResultKey& key, vector<int>& values) const {
+    vector<uint8_t> payload;
+    if (!findPayload(key, payload) || payload.size() % sizeof(int32_t) != 0) {
+        return false;
+    }
+    values.resize(payload.size() / sizeof(int32_t));
+    for (size_t i = 0; i < values.size(); i++) {
+        int32_t value;
+        memcpy(&value, payload.data() + i * sizeof(int32_t), sizeof(int32_t));
+        values[i] = value;
+    }
+    return true;
+}
+
+/**
+ * @brief Store a number, replacing any earlier value of the key
+ *
+ */
+void ResultCache::store(const ResultKey& key, double value) {
+    storePayload(key, &value, sizeof(double));
+}
+
+/**
+ * @brief Store a list of numbers, replacing any earlier value of the key
+ *
+ */
+void ResultCache::store(const ResultKey& key, const vector<int>& values) {
+    vector<int32_t> payload(values.begin(), values.end());
+    storePayload(key, payload.data(), payload.size() * sizeof(int32_t));
+}
+
+/**
+ * @brief Rewrite the file with only the latest record of each key, replacing it atomically
+ *
+ * @return bool whether the file was rewritten
+ */
+bool ResultCache::compact() {
+    MemoryScope scope(MemoryTag::Caches);
+    lock_guard<mutex> lock(_mutex);
+    if (_log == nullptr || !lockFile()) {
+        return false;
+    }
+    // take in what other processes appended since the file was opened, so compaction keeps it
+    _appended.clear();
+    load();
+    bool compacted = compactFile();
+    unlockFile();
+    return compacted;
+}
+
+/**
+ * @brief Get the number of keys stored
+ *
+ * @return size_t
+ */
+size_t ResultCache::getEntryCount() const {
+    lock_guard<mutex> lock(_mutex);
+    return _index.size();
+}
+
+/**
+ * @brief Get the number of lookups that found a result
+ *
+ * @return size_t
+ */
+size_t ResultCache::getHitCount() const {
+    lock_guard<mutex> lock(_mutex);
+    return _hitCount;
+}
+
+/**
+ * @brief Get the number of lookups that found nothing
+ *
+ * @return size_t
+ */
+size_t ResultCache::getMissCount() const {
+    lock_guard<mutex> lock(_mutex);
+    return _missCount;
+}
+
+/**
+ * @brief Find the payload of a key
+ *
+ * @return bool whether the key was found
+ */
+bool ResultCache::findPayload(const ResultKey& key, vector<uint8_t>& payload) const {
+    lock_guard<mutex> lock(_mutex);
+    auto found = _index.find(key);
+    if (found == _index.end()) {
+        _missCount++;
+        return false;
+    }
+    _hitCount++;
+    const Location& location = found->second;
+    const uint8_t* source = location.mapped ? _mapped : _appended.data();
+    payload.assign(source + location.offset, source + location.offset + location.size);
+    return true;
+}
+
+/**
+ * @brief Append a record to the file and the index
+ *
+ */
+void ResultCache::storePayload(const ResultKey& key, const void* payload, size_t size) {
+    MemoryScope scope(MemoryTag::Caches);
+    Record record;
+    record.marker = RECORD_MARKER;
+    record.payloadSize = (uint32_t)size;
+    record.key = key;
+    record.checksum = findChecksum(record, payload);
+
+    lock_guard<mutex> lock(_mutex);
+    auto existing = _index.find(key);
+    if (existing != _index.end()) {
+        _liveBytes -= sizeof(Record) + existing->second.size;
+    }
+    Location location;
+    location.mapped = false;
+    location.offset = _appended.size();
+    location.size = size;
+    _appended.insert(_appended.end(), (const uint8_t*)payload, (const uint8_t*)payload + size);
+    _index[key] = location;
+    _liveBytes += sizeof(Record) + size;
+    _fileBytes += sizeof(Record) + size;
+
+    // one write per record, flushed under the lock, so a crash can only tear the last record and
+    // records of several processes never interleave
+    if (_log != nullptr && lockFile()) {
+        vector<uint8_t> bytes(sizeof(Record) + size);
+        memcpy(bytes.data(), &record, sizeof(Record));
+        memcpy(bytes.data() + sizeof(Record), payload, size);
+        fwrite(bytes.data(), 1, bytes.size(), _log);
+        fflush(_log);
+        unlockFile();
+    }
+}
+
+/**
+ * @brief Map the file and index every valid record up to the first torn or corrupt one
+ *
+ * @return size_t bytes of the file that hold valid records
+ */
+size_t ResultCache::load() {
+    unmap();
+    _index.clear();
+    _liveBytes = 0;
+    _fileBytes = 0;
+
+#ifdef RESULT_CACHE_MMAP
+    int descriptor = ::open(_path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return 0;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED) {
+            _mapped = (const uint8_t*)mapping;
+            _mappedSize = (size_t)status.st_size;
+        }
+    }
+    ::close(descriptor);
+#else
+    ifstream fin(_path, ios::binary);
+    if (fin.fail()) {
+        return 0;
+    }
+    _fileCopy.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+    _mapped = _fileCopy.data();
+    _mappedSize = _fileCopy.size();
+#endif
+
+    _fileBytes = _mappedSize;
+    if (_mappedSize < sizeof(FILE_MAGIC) || memcmp(_mapped, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        return 0;
+    }
+
+    size_t offset = sizeof(FILE_MAGIC);
+    _liveBytes = offset;
+    while (offset + sizeof(Record) <= _mappedSize) {
+        Record record;
+        memcpy(&record, _mapped + offset, sizeof(Record));
+        const uint8_t* payload = _mapped + offset + sizeof(Record);
+        if (record.marker != RECORD_MARKER || record.payloadSize > _mappedSize - offset - sizeof(Record)
+            || findChecksum(record, payload) != record.checksum) {
+            break;
+        }
+
+        // later records of a key replace earlier ones
+        auto existing = _index.find(record.key);
+        if (existing != _index.end()) {
+            _liveBytes -= sizeof(Record) + existing->second.size;
+        }
+        Location location;
+        location.mapped = true;
+        location.offset = offset + sizeof(Record);
+        location.size = record.payloadSize;
+        _index[record.key] = location;
+        _liveBytes += sizeof(Record) + record.payloadSize;
+        offset += sizeof(Record) + record.payloadSize;
+    }
+    return offset;
+}
+
+/**
+ * @brief Release the mapped file
+ *
+ */
+void ResultCache::unmap() {
+#ifdef RESULT_CACHE_MMAP
+    if (_mapped != nullptr) {
+        munmap((void*)_mapped, _mappedSize);
+    }
+#else
+    _fileCopy.clear();
+#endif
+    _mapped = nullptr;
+    _mappedSize = 0;
+}
+
+/**
+ * @brief Write the live records to a new file and move it over the old one, so a crash leaves one or the other;
+ * only called with the file locked, and keeps the new file locked
+ *
+ * @return bool whether the file was rewritten
+ */
+bool ResultCache::compactFile() {
+    MemoryScope scope(MemoryTag::Caches);
+    string temporaryPath = _path + ".tmp";
+    FILE* out = fopen(temporaryPath.c_str(), "wb");
+    if (out == nullptr) {
+        return false;
+    }
+    fwrite(FILE_MAGIC, 1, sizeof(FILE_MAGIC), out);
+    for (const auto& entry : _index) {
+        const uint8_t* payload = (entry.second.mapped ? _mapped : _appended.data()) + entry.second.offset;
+        Record record;
+        record.marker = RECORD_MARKER;
+        record.payloadSize = (uint32_t)entry.second.size;
+        record.key = entry.first;
+        record.checksum = findChecksum(record, payload);
+        fwrite(&record, 1, sizeof(Record), out);
+        fwrite(payload, 1, entry.second.size, out);
+    }
+    bool written = fflush(out) == 0;
+#ifdef RESULT_CACHE_MMAP
+    written = written && fsync(fileno(out)) == 0;
+#else
+    written = written && _commit(_fileno(out)) == 0;
+#endif
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+
+    // replace the old file in one step, never leaving the path without a cache
+#ifdef RESULT_CACHE_MMAP
+    if (rename(temporaryPath.c_str(), _path.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    // and make the rename itself survive a crash
+    filesystem::path directory = filesystem::path(_path).parent_path();
+    int directoryDescriptor = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (directoryDescriptor >= 0) {
+        fsync(directoryDescriptor);
+        ::close(directoryDescriptor);
+    }
+
+    // append to the new file from now on; the old one stays locked until the new one is, so other
+    // processes waiting on it only get in once they can follow to the new file
+    FILE* replaced = _log;
+    _log = fopen(_path.c_str(), "ab");
+    if (_log != nullptr && !lockFile()) {
+        fclose(_log);
+        _log = nullptr;
+    }
+    fclose(replaced);
+#else
+    // an open file can't be replaced here, this process's included; while another process has it
+    // open the move fails and the old file is kept
+    fclose(_log);
+    bool moved = MoveFileExA(temporaryPath.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    if (!moved) {
+        remove(temporaryPath.c_str());
+    }
+    _log = fopen(_path.c_str(), "ab");
+    if (_log != nullptr && !lockFile()) {
+        fclose(_log);
+        _log = nullptr;
+    }
+    if (!moved) {
+        return false;
+    }
+#endif
+    _appended.clear();
+    load();
+    return _log != nullptr;
+}
+
+/**
+ * @brief Lock the file against other processes for appending or compacting, following it to the new file
+ * if another process compacted it meanwhile
+ *
+ * @return bool whether the file is locked
+ */
+bool ResultCache::lockFile() {
+#ifdef RESULT_CACHE_MMAP
+    while (flock(fileno(_log), LOCK_EX) == 0) {
+        struct stat opened;
+        struct stat current;
+        if (fstat(fileno(_log), &opened) != 0 || stat(_path.c_str(), &current) != 0) {
+            flock(fileno(_log), LOCK_UN);
+            return false;
+        }
+        if (opened.st_dev == current.st_dev && opened.st_ino == current.st_ino) {
+            return true;
+        }
+        FILE* reopened = fopen(_path.c_str(), "ab");
+        if (reopened == nullptr) {
+            flock(fileno(_log), LOCK_UN);
+            return false;
+        }
+        fclose(_log);
+        _log = reopened;
+    }
+    return false;
+#else
+    // Windows locks are mandatory, so lock a byte far past the data rather than the records, which
+    // readers still need; an open file can't be replaced there, so it never has to be followed
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = MAXDWORD;
+    return LockFileEx((HANDLE)_get_osfhandle(_fileno(_log)), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) != 0;
+#endif
+}
+
+/**
+ * @brief Let other processes at the file again
+ *
+ */
+void ResultCache::unlockFile() {
+    if (_log == nullptr) {
+        return;
+    }
+#ifdef RESULT_CACHE_MMAP
+    flock(fileno(_log), LOCK_UN);
+#else
+    OVERLAPPED overlapped = {};
+    overlapped.OffsetHigh = MAXDWORD;
+    UnlockFileEx((HANDLE)_get_osfhandle(_fileno(_log)), 0, 1, 0, &overlapped);
+#endif
+}
+
+/**
+ * @brief Cut the locked file to the given size
+ *
+ * @return bool whether the file was cut
+ */
+bool ResultCache::truncateFile(size_t size) {
+#ifdef RESULT_CACHE_MMAP
+    return ftruncate(fileno(_log), (off_t)size) == 0;
+#else
+    return _chsize_s(_fileno(_log), (__int64)size) == 0;
+#endif
+}
+
+/**
+ * @brief Get the checksum of a record and its payload
+ *
+ * @return uint64_t
+ */
+uint64_t ResultCache::findChecksum(const Record& record, const void* payload) {
+    Record unsummed = record;
+    unsummed.checksum = 0;
+    return hashBytes(&unsummed, sizeof(Record)) ^ (hashBytes(payload, record.payloadSize) * 0xD6E8FEB86659FD93ULL);
+}
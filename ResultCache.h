@@ -0,0 +1,218 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Identifies one stored result: the content of both strands, what was computed and with which parameters
+ *
+ */
+struct ResultKey {
+    enum Kind : uint32_t { NucleotideSimilarity = 1, ProteinSimilarity, NucleotideClusters, ProteinClusters, EditDistance };
+
+    uint64_t firstHash = 0;
+    uint64_t secondHash = 0;
+    uint32_t firstLength = 0;
+    uint32_t secondLength = 0;
+    uint32_t kind = 0;
+    uint32_t parameters = 0;
+
+    bool operator==(const ResultKey&) const;
+};
+
+/**
+ * @brief Comparison results kept on disk between runs as an append-only log of checksummed records;
+ * a torn or corrupt tail left by a crash is dropped the next time the file is opened. Several processes
+ * can share the file: appends and compaction take an exclusive advisory lock, and a process whose file was
+ * compacted by another follows it to the new one
+ *
+ */
+class ResultCache {
+    public:
+        /**
+         * @brief Construct a closed ResultCache
+         *
+         */
+        ResultCache();
+
+        /**
+         * @brief Flush and close the cache file
+         *
+         */
+        ~ResultCache();
+
+        ResultCache(const ResultCache&) = delete;
+        ResultCache& operator=(const ResultCache&) = delete;
+
+        /**
+         * @brief Open the cache file (creating it if it is missing), mapping it into memory and indexing its records;
+         * an existing file that is not a cache is left alone and not opened
+         *
+         * @return bool whether the file could be opened
+         */
+        bool open(const std::string&);
+
+        /**
+         * @brief Check whether a file is open
+         *
+         * @return bool
+         */
+        bool isOpen() const;
+
+        /**
+         * @brief Find a stored number
+         *
+         * @return bool whether the key was found
+         */
+        bool find(const ResultKey&, double&) const;
+
+        /**
+         * @brief Find a stored list of numbers
+         *
+         * @return bool whether the key was found
+         */
+        bool find(const ResultKey&, std::vector<int>&) const;
+
+        /**
+         * @brief Store a number, replacing any earlier value of the key
+         *
+         */
+        void store(const ResultKey&, double);
+
+        /**
+         * @brief Store a list of numbers, replacing any earlier value of the key
+         *
+         */
+        void store(const ResultKey&, const std::vector<int>&);
+
+        /**
+         * @brief Rewrite the file with only the latest record of each key, replacing it atomically
+         *
+         * @return bool whether the file was rewritten
+         */
+        bool compact();
+
+        /**
+         * @brief Get the number of keys stored
+         *
+         * @return size_t
+         */
+        size_t getEntryCount() const;
+
+        /**
+         * @brief Get the number of lookups that found a result
+         *
+         * @return size_t
+         */
+        size_t getHitCount() const;
+
+        /**
+         * @brief Get the number of lookups that found nothing
+         *
+         * @return size_t
+         */
+        size_t getMissCount() const;
+
+    private:
+        struct KeyHash {
+            size_t operator()(const ResultKey&) const;
+        };
+
+        struct Record {
+            uint32_t marker;
+            uint32_t payloadSize;
+            ResultKey key;
+            uint64_t checksum;
+        };
+
+        // where the payload of a key is: in the mapped file, or appended during this run
+        struct Location {
+            bool mapped;
+            size_t offset;
+            size_t size;
+        };
+
+        /**
+         * @brief Find the payload of a key
+         *
+         * @return bool whether the key was found
+         */
+        bool findPayload(const ResultKey&, std::vector<uint8_t>&) const;
+
+        /**
+         * @brief Append a record to the file and the index
+         *
+         */
+        void storePayload(const ResultKey&, const void*, size_t);
+
+        /**
+         * @brief Map the file and index every valid record up to the first torn or corrupt one
+         *
+         * @return size_t bytes of the file that hold valid records
+         */
+        size_t load();
+
+        /**
+         * @brief Release the mapped file
+         *
+         */
+        void unmap();
+
+        /**
+         * @brief Write the live records to a new file and move it over the old one, so a crash leaves one or the other;
+         * only called with the file locked, and keeps the new file locked
+         *
+         * @return bool whether the file was rewritten
+         */
+        bool compactFile();
+
+        /**
+         * @brief Lock the file against other processes for appending or compacting, following it to the new file
+         * if another process compacted it meanwhile
+         *
+         * @return bool whether the file is locked
+         */
+        bool lockFile();
+
+        /**
+         * @brief Let other processes at the file again
+         *
+         */
+        void unlockFile();
+
+        /**
+         * @brief Cut the locked file to the given size
+         *
+         * @return bool whether the file was cut
+         */
+        bool truncateFile(size_t);
+
+        /**
+         * @brief Get the checksum of a record and its payload
+         *
+         * @return uint64_t
+         */
+        static uint64_t findChecksum(const Record&, const void*);
+
+        std::string _path;
+        // the file as it was when opened, mapped read-only (or read into _fileCopy without mmap)
+        const uint8_t* _mapped;
+        size_t _mappedSize;
+        std::vector<uint8_t> _fileCopy;
+        std::vector<uint8_t> _appended;
+        std::unordered_map<ResultKey, Location, KeyHash> _index;
+        size_t _liveBytes;
+        size_t _fileBytes;
+        std::FILE* _log;
+        mutable size_t _hitCount;
+        mutable size_t _missCount;
+        mutable std::mutex _mutex;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "ResultExporter.h"
+#include "dna_functions.h"
+#include "Statistics.h"
+#include "StrandStore.h"
+#include "StrandTable.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    typedef ArrowWriter::Type Type;
+
+    // the strand table columns written to the strands file, in order, with their types
+    const StrandTable::Column TABLE_COLUMNS[] = {StrandTable::Column::Class, StrandTable::Column::Length, StrandTable::Column::Offset, StrandTable::Column::GCContent,
+                                                 StrandTable::Column::Hash, StrandTable::Column::Codons, StrandTable::Column::Stops};
+    const char* TABLE_COLUMN_NAMES[] = {"class", "length", "offset", "gc", "hash", "codons", "stops"};
+    const Type TABLE_COLUMN_TYPES[] = {Type::Int32, Type::UInt32, Type::UInt64, Type::Float32, Type::UInt64, Type::UInt32, Type::UInt32};
+    const size_t TABLE_COLUMN_COUNT = sizeof(TABLE_COLUMNS) / sizeof(TABLE_COLUMNS[0]);
+
+    const char* BASE_NAMES[Statistics::BASE_COUNT] = {"a", "c", "g", "t", "other"};
+
+    /**
+     * @brief Get the values of a table column for the given rows: the table's own array when the rows
+     * are consecutive, otherwise a copy gathered into the given buffer
+     *
+     * @return const void*
+     */
+    const void* sliceColumn(const StrandTable& table, size_t column, const uint32_t* rows, size_t count, bool consecutive, vector<uint8_t>& gathered) {
+        size_t width = ArrowWriter::getWidth(TABLE_COLUMN_TYPES[column]);
+        const uint8_t* values = (const uint8_t*)table.getColumnData(TABLE_COLUMNS[column]);
+        if (consecutive) {
+            return values + (size_t)rows[0] * width;
+        }
+        gathered.resize(count * width);
+        for (size_t k = 0; k < count; k++) {
+            memcpy(gathered.data() + k * width, values + (size_t)rows[k] * width, width);
+        }
+        return gathered.data();
+    }
+
+    /**
+     * @brief Lay lists of positions end to end with the offsets where each one starts
+     *
+     */
+    void flattenLists(const vector<vector<int>>& lists, vector<int32_t>& values, vector<int32_t>& offsets) {
+        values.clear();
+        offsets.assign(1, 0);
+        for (const vector<int>& list : lists) {
+            values.insert(values.end(), list.begin(), list.end());
+            offsets.push_back((int32_t)values.size());
+        }
+    }
+}
+
+/**
+ * @brief Construct a ResultExporter for the given species, which are numbered in this order
+ *
+ */
+ResultExporter::ResultExporter(const vector<string>& species) {
+    _species = species;
+}
+
+/**
+ * @brief Create the three files
+ *
+ * @return bool whether every file could be created
+ */
+bool ResultExporter::open(const string& prefix) {
+    vector<ArrowWriter::Field> strandFields = {{"species", Type::UInt16, _species}, {"strand", Type::UInt32}};
+    for (size_t i = 0; i < TABLE_COLUMN_COUNT; i++) {
+        strandFields.push_back({TABLE_COLUMN_NAMES[i], TABLE_COLUMN_TYPES[i]});
+    }
+    for (int base = 0; base < Statistics::BASE_COUNT; base++) {
+        strandFields.push_back({BASE_NAMES[base], Type::UInt64});
+    }
+    strandFields.push_back({"orfs", Type::UInt32});
+    strandFields.push_back({"longest_orf", Type::UInt32});
+
+    vector<ArrowWriter::Field> frameFields = {{"species", Type::UInt16, _species}, {"strand", Type::UInt32}, {"frame", Type::Int8},
+                                              {"start", Type::UInt32}, {"end", Type::UInt32}, {"codons", Type::UInt32}};
+
+    vector<ArrowWriter::Field> pairFields = {{"first", Type::UInt16, _species}, {"second", Type::UInt16, _species}, {"strand", Type::UInt32},
+                                             {"nucleotide_similarity", Type::Float64}, {"protein_similarity", Type::Float64}, {"edit_distance", Type::Int32},
+                                             {"nucleotide_clusters", Type::Int32, true}, {"protein_clusters", Type::Int32, true}};
+
+    return _strands.open(prefix + ".strands.arrow", strandFields) && _frames.open(prefix + ".orfs.arrow", frameFields)
+        && _pairs.open(prefix + ".pairs.arrow", pairFields);
+}
+
+/**
+ * @brief Write the strand statistics and open reading frames of the given rows of a loaded dataset
+ *
+ * @return bool whether everything was written
+ */
+bool ResultExporter::exportSpecies(size_t species, const Dataset& dataset, const vector<uint32_t>& rows) {
+    const StrandTable& table = dataset.getTable();
+    for (size_t start = 0; start < rows.size(); start += BATCH_ROWS) {
+        size_t count = min(BATCH_ROWS, rows.size() - start);
+        const uint32_t* batchRows = rows.data() + start;
+
+        vector<uint64_t> bases[Statistics::BASE_COUNT];
+        for (int base = 0; base < Statistics::BASE_COUNT; base++) {
+            bases[base].resize(count);
+        }
+        vector<vector<OpenReadingFrame>> found(count);
+        vector<uint32_t> frameCounts(count);
+        vector<uint32_t> longestFrames(count);
+        TaskScheduler::shared().parallelFor(count, 16, [&](size_t first, size_t last) {
+            for (size_t k = first; k < last; k++) {
+                string_view sequence = dataset.at(batchRows[k]).getSequence();
+                Statistics::Counts counts = Statistics::countStrand(BaseProfile(sequence));
+                for (int base = 0; base < Statistics::BASE_COUNT; base++) {
+                    bases[base][k] = counts.bases[base];
+                }
+                found[k] = findOpenReadingFrames(sequence, MIN_ORF_CODONS);
+                frameCounts[k] = (uint32_t)found[k].size();
+                longestFrames[k] = 0;
+                for (const OpenReadingFrame& frame : found[k]) {
+                    longestFrames[k] = max(longestFrames[k], (frame.end - frame.start) / 3);
+                }
+            }
+        }, TaskScheduler::Priority::Batch);
+
+        // open reading frames are found per strand, so they are gathered into columns
+        vector<uint16_t> frameSpecies;
+        vector<uint32_t> frameStrands;
+        vector<int8_t> frameNumbers;
+        vector<uint32_t> frameStarts;
+        vector<uint32_t> frameEnds;
+        vector<uint32_t> frameCodons;
+        for (size_t k = 0; k < count; k++) {
+            for (const OpenReadingFrame& frame : found[k]) {
+                frameSpecies.push_back((uint16_t)species);
+                frameStrands.push_back(batchRows[k]);
+                frameNumbers.push_back(frame.frame);
+                frameStarts.push_back(frame.start);
+                frameEnds.push_back(frame.end);
+                frameCodons.push_back((frame.end - frame.start) / 3);
+            }
+        }
+        if (!frameSpecies.empty() && !_frames.writeBatch(frameSpecies.size(), {{frameSpecies.data()}, {frameStrands.data()}, {frameNumbers.data()}, {frameStarts.data()}, {frameEnds.data()}, {frameCodons.data()}})) {
+            return false;
+        }
+
+        // table columns go out straight from the table unless a filter or sort picked the rows
+        bool consecutive = true;
+        for (size_t k = 1; k < count && consecutive; k++) {
+            consecutive = batchRows[k] == batchRows[k - 1] + 1;
+        }
+        vector<uint16_t> speciesColumn(count, (uint16_t)species);
+        vector<ArrowWriter::Column> columns = {{speciesColumn.data()}, {batchRows}};
+        vector<vector<uint8_t>> gathered(TABLE_COLUMN_COUNT);
+        for (size_t i = 0; i < TABLE_COLUMN_COUNT; i++) {
+            columns.push_back({sliceColumn(table, i, batchRows, count, consecutive, gathered[i])});
+        }
+        for (int base = 0; base < Statistics::BASE_COUNT; base++) {
+            columns.push_back({bases[base].data()});
+        }
+        columns.push_back({frameCounts.data()});
+        columns.push_back({longestFrames.data()});
+        if (!_strands.writeBatch(count, columns)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Compare the given rows of two loaded datasets strand by strand and write the results
+ *
+ * @return bool whether everything was written
+ */
+bool ResultExporter::exportPair(size_t firstSpecies, size_t secondSpecies, const Dataset& first, const Dataset& second, const vector<uint32_t>& rows) {
+    for (size_t start = 0; start < rows.size(); start += BATCH_ROWS) {
+        size_t count = min(BATCH_ROWS, rows.size() - start);
+        const uint32_t* batchRows = rows.data() + start;
+
+        // interned strands make repeated pairs (across species pairs too) a memo lookup
+        vector<double> nucleotide(count);
+        vector<double> protein(count);
+        vector<int32_t> distance(count);
+        vector<vector<int>> nucleotideClusters(count);
+        vector<vector<int>> proteinClusters(count);
+        TaskScheduler::shared().parallelFor(count, 16, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                shared_ptr<const DNAStrand> firstStrand = first.getStrand(batchRows[k]);
+                shared_ptr<const DNAStrand> secondStrand = second.getStrand(batchRows[k]);
+                nucleotide[k] = StrandStore::shared().compareDNA(firstStrand, secondStrand);
+                protein[k] = StrandStore::shared().compareProteins(firstStrand, secondStrand);
+                distance[k] = StrandStore::shared().editDistance(firstStrand, secondStrand);
+                nucleotideClusters[k] = StrandStore::shared().findClusters(firstStrand, secondStrand);
+                proteinClusters[k] = StrandStore::shared().findProteinClusters(firstStrand, secondStrand);
+            }
+        }, TaskScheduler::Priority::Batch);
+
+        vector<int32_t> nucleotidePositions;
+        vector<int32_t> nucleotideOffsets;
+        vector<int32_t> proteinPositions;
+        vector<int32_t> proteinOffsets;
+        flattenLists(nucleotideClusters, nucleotidePositions, nucleotideOffsets);
+        flattenLists(proteinClusters, proteinPositions, proteinOffsets);
+        vector<uint16_t> firstColumn(count, (uint16_t)firstSpecies);
+        vector<uint16_t> secondColumn(count, (uint16_t)secondSpecies);
+        if (!_pairs.writeBatch(count, {{firstColumn.data()}, {secondColumn.data()}, {batchRows}, {nucleotide.data()}, {protein.data()}, {distance.data()},
+                                       {nucleotidePositions.data(), nucleotideOffsets.data()}, {proteinPositions.data(), proteinOffsets.data()}})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finish the three files
+ *
+ * @return bool whether every file was written
+ */
+bool ResultExporter::close() {
+    bool strandsWritten = _strands.close();
+    bool framesWritten = _frames.close();
+    bool pairsWritten = _pairs.close();
+    return strandsWritten && framesWritten && pairsWritten;
+}
+
+/**
+ * @brief Get the number of strand rows written
+ *
+ * @return uint64_t
+ */
+uint64_t ResultExporter::getStrandCount() const {
+    return _strands.getRowCount();
+}
+
+/**
+ * @brief Get the number of open reading frame rows written
+ *
+ * @return uint64_t
+ */
+uint64_t ResultExporter::getFrameCount() const {
+    return _frames.getRowCount();
+}
+
+/**
+ * @brief Get the number of strand pair rows written
+ *
+ * @return uint64_t
+ */
+uint64_t ResultExporter::getPairCount() const {
+    return _pairs.getRowCount();
+}
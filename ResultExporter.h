@@ -0,0 +1,92 @@
+#ifndef RESULTEXPORTER_H
+#define RESULTEXPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ArrowWriter.h"
+#include "Dataset.h"
+
+/**
+ * @brief Writes the analysis of loaded datasets as three Arrow IPC files that can be memory mapped
+ * from a notebook (pyarrow.ipc.open_file, pyarrow.feather.read_table, polars.read_ipc):
+ *
+ *   <prefix>.strands.arrow  species, strand, class, length, offset, gc, hash, codons, stops,
+ *                           a, c, g, t, other (base counts), orfs, longest_orf (codons)
+ *   <prefix>.orfs.arrow     species, strand, frame, start, end, codons
+ *   <prefix>.pairs.arrow    first, second, strand, nucleotide_similarity, protein_similarity,
+ *                           edit_distance, nucleotide_clusters, protein_clusters (lists of positions)
+ *
+ * Each file grows by one record batch per block of strands as soon as the block is analysed.
+ */
+class ResultExporter {
+    public:
+        // strands analysed (and rows written) at a time
+        static constexpr size_t BATCH_ROWS = 4096;
+        // shorter open reading frames are not reported
+        static const size_t MIN_ORF_CODONS = 30;
+
+        /**
+         * @brief Construct a ResultExporter for the given species, which are numbered in this order
+         *
+         */
+        explicit ResultExporter(const std::vector<std::string>&);
+
+        /**
+         * @brief Create the three files
+         *
+         * @return bool whether every file could be created
+         */
+        bool open(const std::string&);
+
+        /**
+         * @brief Write the strand statistics and open reading frames of the given rows of a loaded dataset
+         *
+         * @return bool whether everything was written
+         */
+        bool exportSpecies(size_t, const Dataset&, const std::vector<uint32_t>&);
+
+        /**
+         * @brief Compare the given rows of two loaded datasets strand by strand and write the results
+         *
+         * @return bool whether everything was written
+         */
+        bool exportPair(size_t, size_t, const Dataset&, const Dataset&, const std::vector<uint32_t>&);
+
+        /**
+         * @brief Finish the three files
+         *
+         * @return bool whether every file was written
+         */
+        bool close();
+
+        /**
+         * @brief Get the number of strand rows written
+         *
+         * @return uint64_t
+         */
+        uint64_t getStrandCount() const;
+
+        /**
+         * @brief Get the number of open reading frame rows written
+         *
+         * @return uint64_t
+         */
+        uint64_t getFrameCount() const;
+
+        /**
+         * @brief Get the number of strand pair rows written
+         *
+         * @return uint64_t
+         */
+        uint64_t getPairCount() const;
+
+    private:
+        std::vector<std::string> _species;
+        ArrowWriter _strands;
+        ArrowWriter _frames;
+        ArrowWriter _pairs;
+};
+
+#endif
@@ -0,0 +1,455 @@
+#include "Statistics.h"
+#include "MemoryAccounting.h"
+#include "Protein.h"
+#include "TaskScheduler.h"
+#include "sequence_kernels.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const uint64_t LOW_BITS = 0x5555555555555555ULL;
+
+    // only upper case A, C, G and T are bases, as in DNAStrand's codons
+    bool isBase(char base) {
+        switch (base) {
+            case 'A': case 'C': case 'G': case 'T':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Codon table index of three packed DNA bases, read through their pairs like DNAStrand's codons
+     *
+     */
+    struct CodonTable {
+        int index[64];
+
+        CodonTable() {
+            // pairs of A, C, G, T are U, G, C, A, whose digits in the U, C, A, G table order are 0, 3, 1, 2
+            const int pairDigit[4] = {0, 3, 1, 2};
+            for (int i = 0; i < 64; i++) {
+                index[i] = pairDigit[i & 3] * 16 + pairDigit[(i >> 2) & 3] * 4 + pairDigit[(i >> 4) & 3];
+            }
+        }
+    };
+
+    const CodonTable& codonTable() {
+        static const CodonTable table;
+        return table;
+    }
+}
+
+/**
+ * @brief Construct an empty BaseProfile
+ *
+ */
+BaseProfile::BaseProfile() {
+    _length = 0;
+    _prefix.assign(4, 0);
+}
+
+/**
+ * @brief Pack the sequence and count its bases
+ *
+ */
+BaseProfile::BaseProfile(string_view sequence) {
+    MemoryScope scope(MemoryTag::Indexes);
+    _length = sequence.length();
+    size_t wordCount = (_length + WORD_BASES - 1) / WORD_BASES;
+
+    vector<uint8_t> packed(wordCount * 8, 0);
+    packNucleotides(sequence.data(), packed.data(), _length);
+
+    // anything else (U and lower case included) is packed again as A, and counted on its own
+    for (size_t i = 0; i < _length; i++) {
+        if (!isBase(sequence[i])) {
+            if (_other.empty()) {
+                _other.assign((_length + 63) / 64, 0);
+            }
+            _other[i / 64] |= (uint64_t)1 << (i % 64);
+            packed[i / 4] = (uint8_t)(packed[i / 4] & ~(3 << (2 * (i % 4))));
+        }
+    }
+    _words.assign(wordCount, 0);
+    for (size_t w = 0; w < wordCount; w++) {
+        for (size_t k = 0; k < 8; k++) {
+            _words[w] |= (uint64_t)packed[w * 8 + k] << (8 * k);
+        }
+    }
+
+    _prefix.assign(4 * (wordCount + 1), 0);
+    for (size_t w = 0; w < wordCount; w++) {
+        size_t bases = min(WORD_BASES, _length - w * WORD_BASES);
+        for (int code = 0; code < 4; code++) {
+            _prefix[4 * (w + 1) + (size_t)code] = _prefix[4 * w + (size_t)code] + (uint32_t)countInWord(w, code, bases);
+        }
+    }
+
+    if (!_other.empty()) {
+        _otherPrefix.assign(_other.size() + 1, 0);
+        for (size_t w = 0; w < _other.size(); w++) {
+            _otherPrefix[w + 1] = _otherPrefix[w] + (uint32_t)__builtin_popcountll(_other[w]);
+        }
+    }
+}
+
+/**
+ * @brief Get the number of bases profiled
+ *
+ * @return size_t
+ */
+size_t BaseProfile::getLength() const {
+    return _length;
+}
+
+/**
+ * @brief Count one base (Statistics::A, C, G, T or OTHER) in the range [start, end)
+ *
+ * @return size_t
+ */
+size_t BaseProfile::countBase(int base, size_t start, size_t end) const {
+    end = min(end, _length);
+    if (start >= end) {
+        return 0;
+    }
+    if (base == Statistics::OTHER) {
+        return countOtherBefore(end) - countOtherBefore(start);
+    }
+
+    size_t before[2] = {start, end};
+    size_t counts[2];
+    for (size_t i = 0; i < 2; i++) {
+        size_t word = before[i] / WORD_BASES;
+        size_t rest = before[i] % WORD_BASES;
+        counts[i] = _prefix[4 * word + (size_t)base] + (rest > 0 ? countInWord(word, base, rest) : 0);
+    }
+    size_t count = counts[1] - counts[0];
+    if (base == Statistics::A) {
+        count -= countOtherBefore(end) - countOtherBefore(start);
+    }
+    return count;
+}
+
+/**
+ * @brief Get the percentage of G and C among the A, C, G and T bases of the range [start, end)
+ *
+ * @return double
+ */
+double BaseProfile::getGCContent(size_t start, size_t end) const {
+    end = min(end, _length);
+    if (start >= end) {
+        return 0;
+    }
+    size_t gc = countBase(Statistics::G, start, end) + countBase(Statistics::C, start, end);
+    size_t valid = end - start - countBase(Statistics::OTHER, start, end);
+    if (valid == 0) {
+        return 0;
+    }
+    return (double)gc / (double)valid * 100;
+}
+
+/**
+ * @brief Get the packed 2-bit code (A = 0, C = 1, G = 2, T = 3) of the base at a position,
+ * anything else reads as A
+ *
+ * @return int
+ */
+int BaseProfile::getCode(size_t position) const {
+    return (int)((_words[position / WORD_BASES] >> (2 * (position % WORD_BASES))) & 3);
+}
+
+/**
+ * @brief Count the bases with the given code in the first bases of a word
+ *
+ * @return size_t
+ */
+size_t BaseProfile::countInWord(size_t word, int code, size_t bases) const {
+    // bases equal to the code become 00, so both bits of a matching base are clear
+    uint64_t difference = _words[word] ^ (LOW_BITS * (uint64_t)code);
+    uint64_t matches = ~(difference | (difference >> 1)) & LOW_BITS;
+    if (bases < WORD_BASES) {
+        matches &= ((uint64_t)1 << (2 * bases)) - 1;
+    }
+    return (size_t)__builtin_popcountll(matches);
+}
+
+/**
+ * @brief Count the bases outside the alphabet before a position
+ *
+ * @return size_t
+ */
+size_t BaseProfile::countOtherBefore(size_t position) const {
+    if (_other.empty()) {
+        return 0;
+    }
+    size_t word = position / 64;
+    size_t rest = position % 64;
+    size_t count = _otherPrefix[word];
+    if (rest > 0) {
+        count += (size_t)__builtin_popcountll(_other[word] & (((uint64_t)1 << rest) - 1));
+    }
+    return count;
+}
+
+/**
+ * @brief Add another set of counts to this one
+ *
+ */
+void Statistics::Counts::merge(const Counts& other) {
+    for (int i = 0; i < BASE_COUNT; i++) {
+        bases[i] += other.bases[i];
+    }
+    for (int i = 0; i < CODON_COUNT; i++) {
+        codons[i] += other.codons[i];
+    }
+    strandCount += other.strandCount;
+}
+
+/**
+ * @brief Get the total number of bases
+ *
+ * @return uint64_t
+ */
+uint64_t Statistics::Counts::getLength() const {
+    uint64_t length = 0;
+    for (int i = 0; i < BASE_COUNT; i++) {
+        length += bases[i];
+    }
+    return length;
+}
+
+/**
+ * @brief Get the percentage of G and C among the A, C, G and T bases
+ *
+ * @return double
+ */
+double Statistics::Counts::getGCContent() const {
+    uint64_t valid = bases[A] + bases[C] + bases[G] + bases[T];
+    if (valid == 0) {
+        return 0;
+    }
+    return (double)(bases[G] + bases[C]) / (double)valid * 100;
+}
+
+/**
+ * @brief Get the number of complete codons
+ *
+ * @return uint64_t
+ */
+uint64_t Statistics::Counts::getCodonTotal() const {
+    uint64_t total = 0;
+    for (int i = 0; i < CODON_COUNT; i++) {
+        total += codons[i];
+    }
+    return total;
+}
+
+/**
+ * @brief Sum the codon usage by the amino acid (or Stop) each codon codes for
+ *
+ * @return std::map<std::string, uint64_t>
+ */
+map<string, uint64_t> Statistics::Counts::getAminoAcidCounts() const {
+    map<string, uint64_t> aminoAcids;
+    for (int i = 0; i < CODON_COUNT; i++) {
+        aminoAcids[Protein::getProteinName(i)] += codons[i];
+    }
+    return aminoAcids;
+}
+
+/**
+ * @brief Construct empty Statistics
+ *
+ */
+Statistics::Statistics() {
+}
+
+/**
+ * @brief Count every available strand of the datasets on the shared scheduler
+ *
+ */
+void Statistics::compute(const vector<const Dataset*>& datasets) {
+    MemoryScope scope(MemoryTag::Indexes);
+    _species.assign(datasets.size(), Species());
+    vector<size_t> offsets(datasets.size() + 1, 0);
+    for (size_t s = 0; s < datasets.size(); s++) {
+        Species& species = _species.at(s);
+        size_t count = datasets.at(s)->getAvailableCount();
+        species.name = datasets.at(s)->getName();
+        species.strandClasses.resize(count);
+        species.strands.resize(count);
+        species.profiles.resize(count);
+        offsets.at(s + 1) = offsets.at(s) + count;
+    }
+
+    // every chunk keeps its own species and class histograms, merged once when the chunk is done
+    mutex mergeMutex;
+    TaskScheduler::shared().parallelFor(offsets.back(), 8, [&](size_t start, size_t end) {
+        vector<Counts> speciesTotals(_species.size());
+        vector<map<int, Counts>> classTotals(_species.size());
+        for (size_t k = start; k < end; k++) {
+            size_t s = (size_t)(upper_bound(offsets.begin(), offsets.end(), k) - offsets.begin()) - 1;
+            size_t i = k - offsets.at(s);
+            Species& species = _species.at(s);
+
+            species.profiles[i] = BaseProfile(datasets.at(s)->at(i).getSequence());
+            species.strands[i] = countStrand(species.profiles[i]);
+            species.strandClasses[i] = datasets.at(s)->getClass(i);
+            speciesTotals[s].merge(species.strands[i]);
+            classTotals[s][species.strandClasses[i]].merge(species.strands[i]);
+        }
+
+        lock_guard<mutex> lock(mergeMutex);
+        for (size_t s = 0; s < _species.size(); s++) {
+            _species[s].total.merge(speciesTotals[s]);
+            for (const auto& classCounts : classTotals[s]) {
+                _species[s].classes[classCounts.first].merge(classCounts.second);
+            }
+        }
+    }, TaskScheduler::Priority::Batch);
+}
+
+/**
+ * @brief Count the bases and codons of a profiled strand in one pass over its packed bases
+ *
+ * @return Counts
+ */
+Statistics::Counts Statistics::countStrand(const BaseProfile& profile) {
+    Counts counts;
+    size_t length = profile.getLength();
+    for (int base = 0; base < BASE_COUNT; base++) {
+        counts.bases[base] = profile.countBase(base, 0, length);
+    }
+
+    // complete codons only, skipping any with a base outside the alphabet
+    const CodonTable& table = codonTable();
+    bool hasOther = counts.bases[OTHER] > 0;
+    for (size_t i = 0; i + 3 <= length; i += 3) {
+        if (hasOther && profile.countBase(OTHER, i, i + 3) > 0) {
+            continue;
+        }
+        int packed = profile.getCode(i) | profile.getCode(i + 1) << 2 | profile.getCode(i + 2) << 4;
+        counts.codons[table.index[packed]]++;
+    }
+    counts.strandCount = 1;
+    return counts;
+}
+
+/**
+ * @brief Get the number of species counted
+ *
+ * @return size_t
+ */
+size_t Statistics::getSpeciesCount() const {
+    return _species.size();
+}
+
+/**
+ * @brief Get the name of a counted species
+ *
+ * @return std::string
+ */
+string Statistics::getSpeciesName(size_t species) const {
+    return _species.at(species).name;
+}
+
+/**
+ * @brief Get the totals of a species
+ *
+ * @return const Counts&
+ */
+const Statistics::Counts& Statistics::getSpecies(size_t species) const {
+    return _species.at(species).total;
+}
+
+/**
+ * @brief Get the totals of each class of a species, by class number
+ *
+ * @return const std::map<int, Counts>&
+ */
+const map<int, Statistics::Counts>& Statistics::getClasses(size_t species) const {
+    return _species.at(species).classes;
+}
+
+/**
+ * @brief Get the number of strands counted for a species
+ *
+ * @return size_t
+ */
+size_t Statistics::getStrandCount(size_t species) const {
+    return _species.at(species).strands.size();
+}
+
+/**
+ * @brief Get the counts of one strand of a species
+ *
+ * @return const Counts&
+ */
+const Statistics::Counts& Statistics::getStrand(size_t species, size_t strand) const {
+    return _species.at(species).strands.at(strand);
+}
+
+/**
+ * @brief Get the range profile of one strand of a species
+ *
+ * @return const BaseProfile&
+ */
+const BaseProfile& Statistics::getProfile(size_t species, size_t strand) const {
+    return _species.at(species).profiles.at(strand);
+}
+
+/**
+ * @brief Write every species, class and strand as a row of a tab separated table
+ *
+ */
+void Statistics::writeTable(ostream& out) const {
+    out << "level\tspecies\tclass\tstrand\tstrands\tlength\tA\tC\tG\tT\tother\tgc_percent";
+    for (int i = 0; i < CODON_COUNT; i++) {
+        out << "\t" << Protein::getCodonName(i);
+    }
+    map<string, uint64_t> aminoAcids = Counts().getAminoAcidCounts();
+    for (const auto& aminoAcid : aminoAcids) {
+        out << "\t" << aminoAcid.first;
+    }
+    out << "\n";
+
+    for (size_t s = 0; s < _species.size(); s++) {
+        const Species& species = _species.at(s);
+        writeRow(out, "species", species.name, "", "", species.total);
+        for (const auto& classCounts : species.classes) {
+            writeRow(out, "class", species.name, to_string(classCounts.first), "", classCounts.second);
+        }
+        for (size_t i = 0; i < species.strands.size(); i++) {
+            writeRow(out, "strand", species.name, to_string(species.strandClasses.at(i)), to_string(i), species.strands.at(i));
+        }
+    }
+}
+
+/**
+ * @brief Write one row of the table
+ *
+ */
+void Statistics::writeRow(ostream& out, const string& level, const string& species, const string& classNum, const string& strand, const Counts& counts) {
+    out << level << "\t" << species << "\t" << classNum << "\t" << strand << "\t" << counts.strandCount << "\t" << counts.getLength();
+    for (int i = 0; i < BASE_COUNT; i++) {
+        out << "\t" << counts.bases[i];
+    }
+    out << "\t" << counts.getGCContent();
+    for (int i = 0; i < CODON_COUNT; i++) {
+        out << "\t" << counts.codons[i];
+    }
+    map<string, uint64_t> aminoAcids = counts.getAminoAcidCounts();
+    for (const auto& aminoAcid : aminoAcids) {
+        out << "\t" << aminoAcid.second;
+    }
+    out << "\n";
+}
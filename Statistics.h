@@ -0,0 +1,236 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Dataset.h"
+
+/**
+ * @brief Base counts of one strand, packed 32 bases per word with running totals at every
+ * word so the composition of any range is found in constant time
+ *
+ */
+class BaseProfile {
+    public:
+        /**
+         * @brief Construct an empty BaseProfile
+         *
+         */
+        BaseProfile();
+
+        /**
+         * @brief Pack the sequence and count its bases
+         *
+         */
+        explicit BaseProfile(std::string_view);
+
+        /**
+         * @brief Get the number of bases profiled
+         *
+         * @return size_t
+         */
+        size_t getLength() const;
+
+        /**
+         * @brief Count one base (Statistics::A, C, G, T or OTHER) in the range [start, end)
+         *
+         * @return size_t
+         */
+        size_t countBase(int, size_t, size_t) const;
+
+        /**
+         * @brief Get the percentage of G and C among the A, C, G and T bases of the range [start, end)
+         *
+         * @return double
+         */
+        double getGCContent(size_t, size_t) const;
+
+        /**
+         * @brief Get the packed 2-bit code (A = 0, C = 1, G = 2, T = 3) of the base at a position,
+         * anything else reads as A
+         *
+         * @return int
+         */
+        int getCode(size_t) const;
+
+    private:
+        static constexpr size_t WORD_BASES = 32;
+
+        /**
+         * @brief Count the bases with the given code in the first bases of a word
+         *
+         * @return size_t
+         */
+        size_t countInWord(size_t, int, size_t) const;
+
+        /**
+         * @brief Count the bases outside the alphabet before a position
+         *
+         * @return size_t
+         */
+        size_t countOtherBefore(size_t) const;
+
+        size_t _length;
+        std::vector<uint64_t> _words;
+        // four codes per word: how many of each code come before the word
+        std::vector<uint32_t> _prefix;
+        // one bit per base that is not A, C, G, T or U; empty when there are none
+        std::vector<uint64_t> _other;
+        std::vector<uint32_t> _otherPrefix;
+};
+
+/**
+ * @brief Base composition, GC content, codon usage and amino acid frequencies per strand, per class
+ * and per species, computed in parallel across every loaded dataset
+ *
+ */
+class Statistics {
+    public:
+        static const int A = 0;
+        static const int C = 1;
+        static const int G = 2;
+        static const int T = 3;
+        static const int OTHER = 4;
+        static const int BASE_COUNT = 5;
+        static const int CODON_COUNT = 64;
+
+        struct Counts {
+            uint64_t bases[BASE_COUNT] = {};
+            // indexed like the codon table in Protein, counting the codons of the pair sequence
+            uint64_t codons[CODON_COUNT] = {};
+            uint64_t strandCount = 0;
+
+            /**
+             * @brief Add another set of counts to this one
+             *
+             */
+            void merge(const Counts&);
+
+            /**
+             * @brief Get the total number of bases
+             *
+             * @return uint64_t
+             */
+            uint64_t getLength() const;
+
+            /**
+             * @brief Get the percentage of G and C among the A, C, G and T bases
+             *
+             * @return double
+             */
+            double getGCContent() const;
+
+            /**
+             * @brief Get the number of complete codons
+             *
+             * @return uint64_t
+             */
+            uint64_t getCodonTotal() const;
+
+            /**
+             * @brief Sum the codon usage by the amino acid (or Stop) each codon codes for
+             *
+             * @return std::map<std::string, uint64_t>
+             */
+            std::map<std::string, uint64_t> getAminoAcidCounts() const;
+        };
+
+        /**
+         * @brief Construct empty Statistics
+         *
+         */
+        Statistics();
+
+        /**
+         * @brief Count every available strand of the datasets on the shared scheduler
+         *
+         */
+        void compute(const std::vector<const Dataset*>&);
+
+        /**
+         * @brief Count the bases and codons of a profiled strand in one pass over its packed bases
+         *
+         * @return Counts
+         */
+        static Counts countStrand(const BaseProfile&);
+
+        /**
+         * @brief Get the number of species counted
+         *
+         * @return size_t
+         */
+        size_t getSpeciesCount() const;
+
+        /**
+         * @brief Get the name of a counted species
+         *
+         * @return std::string
+         */
+        std::string getSpeciesName(size_t) const;
+
+        /**
+         * @brief Get the totals of a species
+         *
+         * @return const Counts&
+         */
+        const Counts& getSpecies(size_t) const;
+
+        /**
+         * @brief Get the totals of each class of a species, by class number
+         *
+         * @return const std::map<int, Counts>&
+         */
+        const std::map<int, Counts>& getClasses(size_t) const;
+
+        /**
+         * @brief Get the number of strands counted for a species
+         *
+         * @return size_t
+         */
+        size_t getStrandCount(size_t) const;
+
+        /**
+         * @brief Get the counts of one strand of a species
+         *
+         * @return const Counts&
+         */
+        const Counts& getStrand(size_t, size_t) const;
+
+        /**
+         * @brief Get the range profile of one strand of a species
+         *
+         * @return const BaseProfile&
+         */
+        const BaseProfile& getProfile(size_t, size_t) const;
+
+        /**
+         * @brief Write every species, class and strand as a row of a tab separated table
+         *
+         */
+        void writeTable(std::ostream&) const;
+
+    private:
+        struct Species {
+            std::string name;
+            Counts total;
+            std::map<int, Counts> classes;
+            std::vector<int> strandClasses;
+            std::vector<Counts> strands;
+            std::vector<BaseProfile> profiles;
+        };
+
+        /**
+         * @brief Write one row of the table
+         *
+         */
+        static void writeRow(std::ostream&, const std::string&, const std::string&, const std::string&, const std::string&, const Counts&);
+
+        std::vector<Species> _species;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "StrandArena.h"
+#include "MemoryAccounting.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Construct an empty arena for the named species, 0 as the block size giving every allocation
+ * a block of exactly its size (for a single strand)
+ *
+ */
+StrandArena::StrandArena(const string& name, size_t blockSize) {
+    _name = name;
+    _blockSize = blockSize;
+    _usedBytes = 0;
+}
+
+/**
+ * @brief Free every block
+ *
+ */
+StrandArena::~StrandArena() {
+    for (size_t tag = 0; tag < MemoryAccounting::TAG_COUNT; tag++) {
+        for (size_t i = 0; i < _sections[tag].blocks.size(); i++) {
+            delete[] _sections[tag].blocks[i];
+        }
+    }
+}
+
+/**
+ * @brief Get the species name
+ *
+ * @return const std::string&
+ */
+const string& StrandArena::getName() const {
+    return _name;
+}
+
+/**
+ * @brief Get uninitialized memory of the given size and alignment from the blocks of a tag; safe to call
+ * from several threads
+ *
+ * @return void*
+ */
+void* StrandArena::allocate(MemoryTag tag, size_t size, size_t alignment) {
+    // every allocation gets its own address, even an empty one
+    if (size == 0) {
+        size = 1;
+    }
+    lock_guard<mutex> lock(_mutex);
+    Section& section = _sections[(size_t)tag];
+
+    // blocks come from new, which aligns for any fundamental type
+    if (size > _blockSize) {
+        // a block of its own, so the rest of the current block can still be handed out
+        MemoryScope scope(tag);
+        char* block = new char[size];
+        section.blocks.push_back(block);
+        _usedBytes += size;
+        return block;
+    }
+
+    uintptr_t start = ((uintptr_t)section.next + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (section.next == nullptr || start + size > (uintptr_t)section.end) {
+        MemoryScope scope(tag);
+        char* block = new char[_blockSize];
+        section.blocks.push_back(block);
+        section.next = block;
+        section.end = block + _blockSize;
+        start = (uintptr_t)block;
+    }
+    _usedBytes += (size_t)(start - (uintptr_t)section.next) + size;
+    section.next = (char*)(start + size);
+    return (void*)start;
+}
+
+/**
+ * @brief Get the number of blocks
+ *
+ * @return size_t
+ */
+size_t StrandArena::getBlockCount() const {
+    lock_guard<mutex> lock(_mutex);
+    size_t count = 0;
+    for (size_t tag = 0; tag < MemoryAccounting::TAG_COUNT; tag++) {
+        count += _sections[tag].blocks.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Get the number of bytes handed out (alignment padding included)
+ *
+ * @return size_t
+ */
+size_t StrandArena::getUsedBytes() const {
+    lock_guard<mutex> lock(_mutex);
+    return _usedBytes;
+}
@@ -0,0 +1,93 @@
+#ifndef STRANDARENA_H
+#define STRANDARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MemoryAccounting.h"
+
+/**
+ * @brief Keeps the strands of one species and all their data in a few large blocks, handed out front to back
+ * and only freed all at once with the arena. Each memory tag has its own blocks, so the sequences of neighbouring
+ * strands are neighbours in memory and the accounting still tells sequences, pairs, codons and amino acids apart.
+ *
+ * Objects made with create are never destroyed, so they must not own anything that needs freeing.
+ */
+class StrandArena {
+    public:
+        // bytes per block; larger allocations get a block of their own
+        static const size_t BLOCK_SIZE = 256 * 1024;
+
+        /**
+         * @brief Construct an empty arena for the named species, 0 as the block size giving every allocation
+         * a block of exactly its size (for a single strand)
+         *
+         */
+        explicit StrandArena(const std::string&, size_t = BLOCK_SIZE);
+
+        /**
+         * @brief Free every block
+         *
+         */
+        ~StrandArena();
+
+        StrandArena(const StrandArena&) = delete;
+        StrandArena& operator=(const StrandArena&) = delete;
+
+        /**
+         * @brief Get the species name
+         *
+         * @return const std::string&
+         */
+        const std::string& getName() const;
+
+        /**
+         * @brief Get uninitialized memory of the given size and alignment from the blocks of a tag; safe to call
+         * from several threads
+         *
+         * @return void*
+         */
+        void* allocate(MemoryTag, size_t, size_t);
+
+        /**
+         * @brief Construct an object in the blocks of a tag
+         *
+         * @return T*
+         */
+        template <typename T, typename... Args>
+        T* create(MemoryTag tag, Args&&... args) {
+            return new (allocate(tag, sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Get the number of blocks
+         *
+         * @return size_t
+         */
+        size_t getBlockCount() const;
+
+        /**
+         * @brief Get the number of bytes handed out (alignment padding included)
+         *
+         * @return size_t
+         */
+        size_t getUsedBytes() const;
+
+    private:
+        struct Section {
+            std::vector<char*> blocks;
+            char* next = nullptr;
+            char* end = nullptr;
+        };
+
+        std::string _name;
+        size_t _blockSize;
+        Section _sections[MemoryAccounting::TAG_COUNT];
+        size_t _usedBytes;
+        mutable std::mutex _mutex;
+};
+
+#endif
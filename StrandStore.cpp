@@ -0,0 +1,396 @@
+#include "StrandStore.h"
+#include "DNAStrand.h"
+#include "dna_functions.h"
+#include "MemoryAccounting.h"
+#include "StrandArena.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // bump when an algorithm changes its results, so older cached results stop matching
+    const uint32_t RESULT_VERSION = 1;
+    // the fewest entries a map holds before it is pruned
+    const size_t MIN_PRUNE_SIZE = 1024;
+    // pair results kept in memory at most; past that the least recently used go (a result cache keeps them on disk)
+    const size_t MAX_PAIR_RESULTS = 65536;
+}
+
+/**
+ * @brief Construct an empty StrandStore
+ *
+ */
+StrandStore::StrandStore() {
+    _lookupCount = 0;
+    _resultCache = nullptr;
+    _strandPruneSize = MIN_PRUNE_SIZE;
+    _pairPruneSize = MIN_PRUNE_SIZE;
+    _pairUses = 0;
+}
+
+/**
+ * @brief Get the project-wide store shared by every loaded dataset
+ *
+ * @return StrandStore&
+ */
+StrandStore& StrandStore::shared() {
+    static StrandStore store;
+    return store;
+}
+
+/**
+ * @brief Get the strand for a sequence, building it (and its pair, codon and protein data) in the
+ * given arena only the first time the sequence is seen by any dataset; the strand keeps its arena alive.
+ * A strand built by a loader that lost the race to another one is dropped, but its space stays until its arena goes.
+ * A strand found in several datasets is shared by all of them, so it belongs to no single species
+ *
+ * @return std::shared_ptr<const DNAStrand>
+ */
+shared_ptr<const DNAStrand> StrandStore::intern(const string& sequence, const shared_ptr<StrandArena>& arena) {
+    uint64_t hash = hashSequence(sequence);
+    {
+        MemoryScope scope(MemoryTag::Caches);
+        lock_guard<mutex> lock(_mutex);
+        _lookupCount++;
+        vector<weak_ptr<const DNAStrand>>& bucket = _strands[hash];
+        for (size_t i = 0; i < bucket.size(); i++) {
+            shared_ptr<const DNAStrand> existing = bucket[i].lock();
+            if (existing != nullptr && existing->getSequence() == sequence) {
+                return existing;
+            }
+        }
+    }
+
+    // build outside the lock; if another loader interned the same sequence meanwhile, keep theirs. The space
+    // of this one is only reclaimed with the whole arena, since arenas never free single objects.
+    // Each strand has a handle of its own (so the memo sees it expire as soon as no dataset uses it) that
+    // keeps the arena alive, as the strand's data lives in it; strands in an arena are never destroyed
+    const DNAStrand* strand = arena->create<DNAStrand>(MemoryTag::Sequences, *arena, sequence, 0);
+    MemoryScope scope(MemoryTag::Caches);
+    shared_ptr<const DNAStrand> created(strand, [arena](const DNAStrand*) {});
+
+    lock_guard<mutex> lock(_mutex);
+    if (_strands.size() >= _strandPruneSize) {
+        pruneStrands();
+    }
+    vector<weak_ptr<const DNAStrand>>& bucket = _strands[hash];
+    for (size_t i = 0; i < bucket.size(); i++) {
+        shared_ptr<const DNAStrand> existing = bucket[i].lock();
+        if (existing != nullptr && existing->getSequence() == sequence) {
+            return existing;
+        }
+    }
+
+    // reuse a slot whose strand was freed
+    for (size_t i = 0; i < bucket.size(); i++) {
+        if (bucket[i].expired()) {
+            bucket[i] = created;
+            return created;
+        }
+    }
+    bucket.push_back(created);
+    return created;
+}
+
+/**
+ * @brief compareDNA of two interned strands, computed once per pair of strands
+ *
+ * @return double
+ */
+double StrandStore::compareDNA(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    ResultKey key;
+    ResultCache* cache;
+    {
+        lock_guard<mutex> lock(_mutex);
+        PairResult& result = findPair(first, second);
+        if (result.nucleotideSimilarity >= 0) {
+            return result.nucleotideSimilarity;
+        }
+        cache = _resultCache;
+        if (cache != nullptr) {
+            key = findKey(first, second, ResultKey::NucleotideSimilarity);
+        }
+    }
+
+    double similarity;
+    if (cache == nullptr || !cache->find(key, similarity)) {
+        similarity = first->compareDNA(*second);
+        if (cache != nullptr) {
+            cache->store(key, similarity);
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    findPair(first, second).nucleotideSimilarity = similarity;
+    return similarity;
+}
+
+/**
+ * @brief compareProteins of two interned strands, computed once per pair of strands
+ *
+ * @return double
+ */
+double StrandStore::compareProteins(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    ResultKey key;
+    ResultCache* cache;
+    {
+        lock_guard<mutex> lock(_mutex);
+        PairResult& result = findPair(first, second);
+        if (result.proteinSimilarity >= 0) {
+            return result.proteinSimilarity;
+        }
+        cache = _resultCache;
+        if (cache != nullptr) {
+            key = findKey(first, second, ResultKey::ProteinSimilarity);
+        }
+    }
+
+    double similarity;
+    if (cache == nullptr || !cache->find(key, similarity)) {
+        similarity = first->compareProteins(*second);
+        if (cache != nullptr) {
+            cache->store(key, similarity);
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    findPair(first, second).proteinSimilarity = similarity;
+    return similarity;
+}
+
+/**
+ * @brief findClusters of two interned strands, computed once per pair of strands
+ *
+ * @return std::vector<int>
+ */
+vector<int> StrandStore::findClusters(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    ResultKey key;
+    ResultCache* cache;
+    {
+        lock_guard<mutex> lock(_mutex);
+        PairResult& result = findPair(first, second);
+        if (result.hasClusters) {
+            return result.clusters;
+        }
+        cache = _resultCache;
+        if (cache != nullptr) {
+            key = findKey(first, second, ResultKey::NucleotideClusters);
+        }
+    }
+
+    vector<int> clusters;
+    if (cache == nullptr || !cache->find(key, clusters)) {
+        clusters = first->findClusters(*second);
+        if (cache != nullptr) {
+            cache->store(key, clusters);
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    MemoryScope scope(MemoryTag::Caches);
+    PairResult& result = findPair(first, second);
+    result.clusters = clusters;
+    result.hasClusters = true;
+    return clusters;
+}
+
+/**
+ * @brief findProteinClusters of two interned strands, computed once per pair of strands
+ *
+ * @return std::vector<int>
+ */
+vector<int> StrandStore::findProteinClusters(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    ResultKey key;
+    ResultCache* cache;
+    {
+        lock_guard<mutex> lock(_mutex);
+        PairResult& result = findPair(first, second);
+        if (result.hasProteinClusters) {
+            return result.proteinClusters;
+        }
+        cache = _resultCache;
+        if (cache != nullptr) {
+            key = findKey(first, second, ResultKey::ProteinClusters);
+        }
+    }
+
+    vector<int> clusters;
+    if (cache == nullptr || !cache->find(key, clusters)) {
+        clusters = first->findProteinClusters(*second);
+        if (cache != nullptr) {
+            cache->store(key, clusters);
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    MemoryScope scope(MemoryTag::Caches);
+    PairResult& result = findPair(first, second);
+    result.proteinClusters = clusters;
+    result.hasProteinClusters = true;
+    return clusters;
+}
+
+/**
+ * @brief editDistance of two interned strands, computed once per pair of strands
+ *
+ * @return int
+ */
+int StrandStore::editDistance(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    ResultKey key;
+    ResultCache* cache;
+    {
+        lock_guard<mutex> lock(_mutex);
+        PairResult& result = findPair(first, second);
+        if (result.editDistance >= 0) {
+            return result.editDistance;
+        }
+        cache = _resultCache;
+        if (cache != nullptr) {
+            key = findKey(first, second, ResultKey::EditDistance);
+        }
+    }
+
+    // stored as a number so it shares the similarity record layout
+    double distance;
+    if (cache == nullptr || !cache->find(key, distance)) {
+        distance = first->editDistance(*second);
+        if (cache != nullptr) {
+            cache->store(key, distance);
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    findPair(first, second).editDistance = (int)distance;
+    return (int)distance;
+}
+
+/**
+ * @brief Check (and fill) a persistent cache before computing any result, so results outlive the run;
+ * nullptr turns it off
+ *
+ */
+void StrandStore::setResultCache(ResultCache* cache) {
+    lock_guard<mutex> lock(_mutex);
+    _resultCache = cache;
+}
+
+/**
+ * @brief Get the number of intern calls
+ *
+ * @return size_t
+ */
+size_t StrandStore::getLookupCount() const {
+    lock_guard<mutex> lock(_mutex);
+    return _lookupCount;
+}
+
+/**
+ * @brief Get the number of distinct strands that are still alive
+ *
+ * @return size_t
+ */
+size_t StrandStore::getUniqueCount() const {
+    lock_guard<mutex> lock(_mutex);
+    size_t count = 0;
+    for (const auto& bucket : _strands) {
+        for (size_t i = 0; i < bucket.second.size(); i++) {
+            count += !bucket.second[i].expired();
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Find the memo entry for a pair, resetting it if either strand was freed and its address reused
+ *
+ * @return PairResult&
+ */
+StrandStore::PairResult& StrandStore::findPair(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second) {
+    MemoryScope scope(MemoryTag::Caches);
+    pair<const DNAStrand*, const DNAStrand*> strands = make_pair(first.get(), second.get());
+    auto found = _pairs.find(strands);
+    if (found == _pairs.end()) {
+        if (_pairs.size() >= _pairPruneSize) {
+            prunePairs();
+        }
+        found = _pairs.emplace(strands, PairResult()).first;
+    }
+
+    PairResult& result = found->second;
+    if (result.first.lock() != first || result.second.lock() != second) {
+        result = PairResult();
+        result.first = first;
+        result.second = second;
+    }
+    result.lastUse = ++_pairUses;
+    return result;
+}
+
+/**
+ * @brief Drop the buckets whose strands were all freed
+ *
+ */
+void StrandStore::pruneStrands() {
+    for (auto bucket = _strands.begin(); bucket != _strands.end();) {
+        vector<weak_ptr<const DNAStrand>>& strands = bucket->second;
+        strands.erase(remove_if(strands.begin(), strands.end(), [](const weak_ptr<const DNAStrand>& strand) {
+            return strand.expired();
+        }), strands.end());
+        bucket = strands.empty() ? _strands.erase(bucket) : next(bucket);
+    }
+    _strandPruneSize = max(MIN_PRUNE_SIZE, 2 * _strands.size());
+}
+
+/**
+ * @brief Drop the memo entries of freed strands, then the least recently used ones past half of MAX_PAIR_RESULTS
+ *
+ */
+void StrandStore::prunePairs() {
+    for (auto entry = _pairs.begin(); entry != _pairs.end();) {
+        bool freed = entry->second.first.expired() || entry->second.second.expired();
+        entry = freed ? _pairs.erase(entry) : next(entry);
+    }
+
+    size_t kept = MAX_PAIR_RESULTS / 2;
+    if (_pairs.size() > kept) {
+        vector<uint64_t> uses;
+        uses.reserve(_pairs.size());
+        for (const auto& entry : _pairs) {
+            uses.push_back(entry.second.lastUse);
+        }
+        // uses are unique, so exactly the entries up to the cutoff go
+        size_t dropped = _pairs.size() - kept;
+        nth_element(uses.begin(), uses.begin() + (ptrdiff_t)(dropped - 1), uses.end());
+        uint64_t cutoff = uses[dropped - 1];
+        for (auto entry = _pairs.begin(); entry != _pairs.end();) {
+            entry = entry->second.lastUse <= cutoff ? _pairs.erase(entry) : next(entry);
+        }
+    }
+    _pairPruneSize = min(MAX_PAIR_RESULTS, max(MIN_PRUNE_SIZE, 2 * _pairs.size()));
+}
+
+/**
+ * @brief Get the persistent cache key of a result of a pair, hashing the strands the first time
+ *
+ * @return ResultKey
+ */
+ResultKey StrandStore::findKey(const shared_ptr<const DNAStrand>& first, const shared_ptr<const DNAStrand>& second, uint32_t kind) {
+    PairResult& result = findPair(first, second);
+    if (!result.hashed) {
+        result.firstHash = hashSequence(first->getSequence());
+        result.secondHash = hashSequence(second->getSequence());
+        result.hashed = true;
+    }
+    ResultKey key;
+    key.firstHash = result.firstHash;
+    key.secondHash = result.secondHash;
+    key.firstLength = (uint32_t)first->getSequence().length();
+    key.secondLength = (uint32_t)second->getSequence().length();
+    key.kind = kind;
+    key.parameters = RESULT_VERSION;
+    return key;
+}
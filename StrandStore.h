@@ -0,0 +1,157 @@
+#ifndef STRANDSTORE_H
+#define STRANDSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "DNAStrand.h"
+#include "ResultCache.h"
+#include "StrandArena.h"
+
+class StrandStore {
+    public:
+        /**
+         * @brief Construct an empty StrandStore
+         *
+         */
+        StrandStore();
+
+        StrandStore(const StrandStore&) = delete;
+        StrandStore& operator=(const StrandStore&) = delete;
+
+        /**
+         * @brief Get the project-wide store shared by every loaded dataset
+         *
+         * @return StrandStore&
+         */
+        static StrandStore& shared();
+
+        /**
+         * @brief Get the strand for a sequence, building it (and its pair, codon and protein data) in the
+         * given arena only the first time the sequence is seen by any dataset; the strand keeps its arena alive.
+         * A strand built by a loader that lost the race to another one is dropped, but its space stays until its arena goes.
+         * A strand found in several datasets is shared by all of them, so it belongs to no single species
+         *
+         * @return std::shared_ptr<const DNAStrand>
+         */
+        std::shared_ptr<const DNAStrand> intern(const std::string&, const std::shared_ptr<StrandArena>&);
+
+        /**
+         * @brief compareDNA of two interned strands, computed once per pair of strands
+         *
+         * @return double
+         */
+        double compareDNA(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief compareProteins of two interned strands, computed once per pair of strands
+         *
+         * @return double
+         */
+        double compareProteins(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief findClusters of two interned strands, computed once per pair of strands
+         *
+         * @return std::vector<int>
+         */
+        std::vector<int> findClusters(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief findProteinClusters of two interned strands, computed once per pair of strands
+         *
+         * @return std::vector<int>
+         */
+        std::vector<int> findProteinClusters(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief editDistance of two interned strands, computed once per pair of strands
+         *
+         * @return int
+         */
+        int editDistance(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief Check (and fill) a persistent cache before computing any result, so results outlive the run;
+         * nullptr turns it off
+         *
+         */
+        void setResultCache(ResultCache*);
+
+        /**
+         * @brief Get the number of intern calls
+         *
+         * @return size_t
+         */
+        size_t getLookupCount() const;
+
+        /**
+         * @brief Get the number of distinct strands that are still alive
+         *
+         * @return size_t
+         */
+        size_t getUniqueCount() const;
+
+    private:
+        struct PairResult {
+            std::weak_ptr<const DNAStrand> first;
+            std::weak_ptr<const DNAStrand> second;
+            double nucleotideSimilarity = -1;
+            double proteinSimilarity = -1;
+            int editDistance = -1;
+            bool hasClusters = false;
+            bool hasProteinClusters = false;
+            std::vector<int> clusters;
+            std::vector<int> proteinClusters;
+            bool hashed = false;
+            uint64_t firstHash = 0;
+            uint64_t secondHash = 0;
+            // when the pair was last looked up, in lookups of any pair
+            uint64_t lastUse = 0;
+        };
+
+        /**
+         * @brief Find the memo entry for a pair, resetting it if either strand was freed and its address reused
+         *
+         * @return PairResult&
+         */
+        PairResult& findPair(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&);
+
+        /**
+         * @brief Drop the buckets whose strands were all freed
+         *
+         */
+        void pruneStrands();
+
+        /**
+         * @brief Drop the memo entries of freed strands, then the least recently used ones past half of MAX_PAIR_RESULTS
+         *
+         */
+        void prunePairs();
+
+        /**
+         * @brief Get the persistent cache key of a result of a pair, hashing the strands the first time
+         *
+         * @return ResultKey
+         */
+        ResultKey findKey(const std::shared_ptr<const DNAStrand>&, const std::shared_ptr<const DNAStrand>&, uint32_t);
+
+        // sequences are bucketed by content hash, colliding sequences share a bucket
+        std::unordered_map<uint64_t, std::vector<std::weak_ptr<const DNAStrand>>> _strands;
+        std::map<std::pair<const DNAStrand*, const DNAStrand*>, PairResult> _pairs;
+        // both maps are pruned when they grow to these sizes, which double with what survives
+        size_t _strandPruneSize;
+        size_t _pairPruneSize;
+        uint64_t _pairUses;
+        mutable std::mutex _mutex;
+        size_t _lookupCount;
+        ResultCache* _resultCache;
+};
+
+#endif
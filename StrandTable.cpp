@@ -0,0 +1,428 @@
+#include "StrandTable.h"
+#include "dna_functions.h"
+#include "MemoryAccounting.h"
+#include "Protein.h"
+#include "Statistics.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // rows filtered together; the columns are padded to a whole number of blocks so every loop has a fixed length
+    const size_t BLOCK_ROWS = 1024;
+
+    // codon indices that translate to a stop
+    const vector<int>& stopCodons() {
+        static const vector<int> codons = []() {
+            vector<int> found;
+            for (int i = 0; i < Statistics::CODON_COUNT; i++) {
+                if (Protein::getProteinName(i) == "Stop") {
+                    found.push_back(i);
+                }
+            }
+            return found;
+        }();
+        return codons;
+    }
+
+    // clear the mask of every row of a block whose value fails the comparison; branch-free fixed-length passes the compiler can vectorize
+    template <class T>
+    void matchColumn(const T* values, StrandTable::Comparison comparison, T value, uint8_t* mask) {
+        // compared into a local array first, which can't alias the column, so no loop needs an overlap check
+        uint8_t matched[BLOCK_ROWS];
+        switch (comparison) {
+            case StrandTable::Comparison::Less:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] < value);
+                }
+                break;
+            case StrandTable::Comparison::LessEqual:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] <= value);
+                }
+                break;
+            case StrandTable::Comparison::Equal:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] == value);
+                }
+                break;
+            case StrandTable::Comparison::NotEqual:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] != value);
+                }
+                break;
+            case StrandTable::Comparison::GreaterEqual:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] >= value);
+                }
+                break;
+            case StrandTable::Comparison::Greater:
+                for (size_t i = 0; i < BLOCK_ROWS; i++) {
+                    matched[i] = (uint8_t)(values[i] > value);
+                }
+                break;
+        }
+        for (size_t i = 0; i < BLOCK_ROWS; i++) {
+            mask[i] &= matched[i];
+        }
+    }
+
+    // integer columns compare against the integer that gives the same answer, or match all or nothing
+    template <class T>
+    void matchIntegerColumn(const T* values, StrandTable::Comparison comparison, double value, uint8_t* mask) {
+        bool roundUp = comparison == StrandTable::Comparison::Less || comparison == StrandTable::Comparison::GreaterEqual;
+        double rounded = roundUp ? ceil(value) : floor(value);
+        bool none = false;
+        bool all = false;
+        if (comparison == StrandTable::Comparison::Equal || comparison == StrandTable::Comparison::NotEqual) {
+            bool outside = rounded != value || rounded < (double)numeric_limits<T>::lowest() || rounded >= (double)numeric_limits<T>::max() + 1.0;
+            none = outside && comparison == StrandTable::Comparison::Equal;
+            all = outside && comparison == StrandTable::Comparison::NotEqual;
+        } else if (rounded < (double)numeric_limits<T>::lowest()) {
+            none = comparison == StrandTable::Comparison::Less || comparison == StrandTable::Comparison::LessEqual;
+            all = !none;
+        } else if (rounded >= (double)numeric_limits<T>::max() + 1.0) {
+            none = comparison == StrandTable::Comparison::Greater || comparison == StrandTable::Comparison::GreaterEqual;
+            all = !none;
+        }
+        if (none) {
+            fill(mask, mask + BLOCK_ROWS, (uint8_t)0);
+        } else if (!all) {
+            matchColumn(values, comparison, (T)rounded, mask);
+        }
+    }
+
+    // order rows by one column, ties keeping their row order
+    template <class T>
+    void sortByColumn(const vector<T>& column, vector<uint32_t>& rows, bool descending) {
+        if (descending) {
+            stable_sort(rows.begin(), rows.end(), [&column](uint32_t a, uint32_t b) { return column[a] > column[b]; });
+        } else {
+            stable_sort(rows.begin(), rows.end(), [&column](uint32_t a, uint32_t b) { return column[a] < column[b]; });
+        }
+    }
+}
+
+/**
+ * @brief Construct an empty StrandTable
+ *
+ */
+StrandTable::StrandTable() {
+    _rowCount = 0;
+}
+
+/**
+ * @brief Fill the table from the strands of a dataset and their classes, one row per strand
+ *
+ */
+void StrandTable::build(const vector<shared_ptr<const DNAStrand>>& strands, const vector<int>& classes) {
+    MemoryScope scope(MemoryTag::Indexes);
+    size_t count = strands.size();
+    size_t padded = (count + BLOCK_ROWS - 1) / BLOCK_ROWS * BLOCK_ROWS;
+    _rowCount = count;
+    _classes.assign(classes.begin(), classes.end());
+    _classes.resize(padded);
+    _lengths.assign(padded, 0);
+    _offsets.assign(padded, 0);
+    _gcContents.assign(padded, 0);
+    _hashes.assign(padded, 0);
+    _codonCounts.assign(padded, 0);
+    _stopCounts.assign(padded, 0);
+
+    TaskScheduler::shared().parallelFor(count, 16, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            string_view sequence = strands[i]->getSequence();
+            Statistics::Counts counts = Statistics::countStrand(BaseProfile(sequence));
+            uint64_t stops = 0;
+            for (size_t j = 0; j < stopCodons().size(); j++) {
+                stops += counts.codons[stopCodons()[j]];
+            }
+            _lengths[i] = (uint32_t)sequence.length();
+            _gcContents[i] = (float)counts.getGCContent();
+            _hashes[i] = hashSequence(sequence);
+            _codonCounts[i] = (uint32_t)counts.getCodonTotal();
+            _stopCounts[i] = (uint32_t)stops;
+        }
+    }, TaskScheduler::Priority::Batch);
+
+    uint64_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        _offsets[i] = offset;
+        offset += _lengths[i];
+    }
+}
+
+/**
+ * @brief Get the number of rows
+ *
+ * @return size_t
+ */
+size_t StrandTable::getRowCount() const {
+    return _rowCount;
+}
+
+/**
+ * @brief Get the class of a row
+ *
+ * @return int
+ */
+int StrandTable::getClass(size_t row) const {
+    return _classes.at(row);
+}
+
+/**
+ * @brief Get the number of bases of a row
+ *
+ * @return uint32_t
+ */
+uint32_t StrandTable::getLength(size_t row) const {
+    return _lengths.at(row);
+}
+
+/**
+ * @brief Get where a row starts if the sequences of the dataset were laid end to end
+ *
+ * @return uint64_t
+ */
+uint64_t StrandTable::getOffset(size_t row) const {
+    return _offsets.at(row);
+}
+
+/**
+ * @brief Get the GC content of a row as a percentage
+ *
+ * @return float
+ */
+float StrandTable::getGCContent(size_t row) const {
+    return _gcContents.at(row);
+}
+
+/**
+ * @brief Get the content hash of a row (the one the strand store interns by)
+ *
+ * @return uint64_t
+ */
+uint64_t StrandTable::getHash(size_t row) const {
+    return _hashes.at(row);
+}
+
+/**
+ * @brief Get the number of complete codons of a row
+ *
+ * @return uint32_t
+ */
+uint32_t StrandTable::getCodonCount(size_t row) const {
+    return _codonCounts.at(row);
+}
+
+/**
+ * @brief Get the number of stop codons of a row
+ *
+ * @return uint32_t
+ */
+uint32_t StrandTable::getStopCount(size_t row) const {
+    return _stopCounts.at(row);
+}
+
+/**
+ * @brief Get the values of a column as one contiguous array indexed by row, of the type its
+ * getter returns (int32_t for the class)
+ *
+ * @return const void*
+ */
+const void* StrandTable::getColumnData(Column column) const {
+    switch (column) {
+        case Column::Class:
+            return _classes.data();
+        case Column::Length:
+            return _lengths.data();
+        case Column::Offset:
+            return _offsets.data();
+        case Column::GCContent:
+            return _gcContents.data();
+        case Column::Hash:
+            return _hashes.data();
+        case Column::Codons:
+            return _codonCounts.data();
+        case Column::Stops:
+            return _stopCounts.data();
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Get the rows matching every predicate in ascending order, testing one column at a time
+ *
+ * @return std::vector<uint32_t>
+ */
+vector<uint32_t> StrandTable::select(const vector<Predicate>& predicates) const {
+    vector<uint32_t> rows;
+    uint8_t mask[BLOCK_ROWS];
+    for (size_t start = 0; start < _rowCount; start += BLOCK_ROWS) {
+        fill(mask, mask + BLOCK_ROWS, (uint8_t)1);
+        bool any = true;
+        for (size_t p = 0; p < predicates.size() && any; p++) {
+            const Predicate& predicate = predicates.at(p);
+            switch (predicate.column) {
+                case Column::Class:
+                    matchIntegerColumn(_classes.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+                case Column::Length:
+                    matchIntegerColumn(_lengths.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+                case Column::Offset:
+                    matchIntegerColumn(_offsets.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+                case Column::GCContent:
+                    matchColumn(_gcContents.data() + start, predicate.comparison, (float)predicate.value, mask);
+                    break;
+                case Column::Hash:
+                    matchIntegerColumn(_hashes.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+                case Column::Codons:
+                    matchIntegerColumn(_codonCounts.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+                case Column::Stops:
+                    matchIntegerColumn(_stopCounts.data() + start, predicate.comparison, predicate.value, mask);
+                    break;
+            }
+            // the rest of the predicates can be skipped once nothing in the block is left
+            uint64_t left = 0;
+            for (size_t i = 0; i < BLOCK_ROWS; i += 8) {
+                uint64_t word;
+                memcpy(&word, mask + i, sizeof(word));
+                left |= word;
+            }
+            any = left != 0;
+        }
+        if (!any) {
+            continue;
+        }
+
+        // padding rows past the end never match; the mask is read eight rows at a time
+        size_t blockRows = min(BLOCK_ROWS, _rowCount - start);
+        fill(mask + blockRows, mask + BLOCK_ROWS, (uint8_t)0);
+        for (size_t i = 0; i < BLOCK_ROWS; i += 8) {
+            uint64_t word;
+            memcpy(&word, mask + i, sizeof(word));
+            while (word != 0) {
+#if defined(__GNUC__)
+                size_t bit = (size_t)__builtin_ctzll(word);
+#else
+                size_t bit = 0;
+                while (((word >> bit) & 1) == 0) {
+                    bit++;
+                }
+#endif
+                rows.push_back((uint32_t)(start + i + bit / 8));
+                word &= word - 1;
+            }
+        }
+    }
+    return rows;
+}
+
+/**
+ * @brief Sort selected rows by a column, keeping the row order among equal values
+ *
+ */
+void StrandTable::sortRows(vector<uint32_t>& rows, Column column, bool descending) const {
+    switch (column) {
+        case Column::Class:
+            sortByColumn(_classes, rows, descending);
+            break;
+        case Column::Length:
+            sortByColumn(_lengths, rows, descending);
+            break;
+        case Column::Offset:
+            sortByColumn(_offsets, rows, descending);
+            break;
+        case Column::GCContent:
+            sortByColumn(_gcContents, rows, descending);
+            break;
+        case Column::Hash:
+            sortByColumn(_hashes, rows, descending);
+            break;
+        case Column::Codons:
+            sortByColumn(_codonCounts, rows, descending);
+            break;
+        case Column::Stops:
+            sortByColumn(_stopCounts, rows, descending);
+            break;
+    }
+}
+
+/**
+ * @brief Parse a column name (class, length, offset, gc, hash, codons or stops)
+ *
+ * @return bool whether the name is a column
+ */
+bool StrandTable::parseColumn(const string& name, Column& column) {
+    const string names[] = {"class", "length", "offset", "gc", "hash", "codons", "stops"};
+    const Column columns[] = {Column::Class, Column::Length, Column::Offset, Column::GCContent, Column::Hash, Column::Codons, Column::Stops};
+    for (size_t i = 0; i < 7; i++) {
+        if (name == names[i]) {
+            column = columns[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parse comma separated predicates such as "class=4,length>1000,gc>45"
+ *
+ * @return bool whether every predicate could be parsed
+ */
+bool StrandTable::parsePredicates(const string& text, vector<Predicate>& predicates) {
+    // longer operators first so "<=" isn't read as "<"
+    const string operators[] = {"<=", ">=", "!=", "==", "<", ">", "="};
+    const Comparison comparisons[] = {Comparison::LessEqual, Comparison::GreaterEqual, Comparison::NotEqual, Comparison::Equal,
+                                      Comparison::Less, Comparison::Greater, Comparison::Equal};
+    istringstream terms(text);
+    string term;
+    while (getline(terms, term, ',')) {
+        term.erase(remove(term.begin(), term.end(), ' '), term.end());
+        if (term.empty()) {
+            continue;
+        }
+        size_t found = string::npos;
+        size_t op = 0;
+        for (size_t i = 0; i < 7 && found == string::npos; i++) {
+            found = term.find(operators[i]);
+            op = i;
+        }
+        if (found == string::npos) {
+            return false;
+        }
+
+        Predicate predicate;
+        if (!parseColumn(term.substr(0, found), predicate.column)) {
+            return false;
+        }
+        predicate.comparison = comparisons[op];
+        string value = term.substr(found + operators[op].size());
+        if (!value.empty() && value.back() == '%') {
+            value.pop_back();
+        }
+        size_t parsed = 0;
+        try {
+            predicate.value = stod(value, &parsed);
+        } catch (const exception&) {
+            return false;
+        }
+        if (parsed != value.size()) {
+            return false;
+        }
+        predicates.push_back(predicate);
+    }
+    return true;
+}
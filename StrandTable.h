@@ -0,0 +1,147 @@
+#ifndef STRANDTABLE_H
+#define STRANDTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DNAStrand.h"
+
+/**
+ * @brief Per strand metadata of a dataset stored column by column, so a filter or sort only reads
+ * the few contiguous arrays it needs instead of every strand object
+ *
+ */
+class StrandTable {
+    public:
+        enum class Column { Class, Length, Offset, GCContent, Hash, Codons, Stops };
+
+        enum class Comparison { Less, LessEqual, Equal, NotEqual, GreaterEqual, Greater };
+
+        /**
+         * @brief One condition on a column, such as length > 1000
+         *
+         */
+        struct Predicate {
+            Column column;
+            Comparison comparison;
+            double value;
+        };
+
+        /**
+         * @brief Construct an empty StrandTable
+         *
+         */
+        StrandTable();
+
+        /**
+         * @brief Fill the table from the strands of a dataset and their classes, one row per strand
+         *
+         */
+        void build(const std::vector<std::shared_ptr<const DNAStrand>>&, const std::vector<int>&);
+
+        /**
+         * @brief Get the number of rows
+         *
+         * @return size_t
+         */
+        size_t getRowCount() const;
+
+        /**
+         * @brief Get the class of a row
+         *
+         * @return int
+         */
+        int getClass(size_t) const;
+
+        /**
+         * @brief Get the number of bases of a row
+         *
+         * @return uint32_t
+         */
+        uint32_t getLength(size_t) const;
+
+        /**
+         * @brief Get where a row starts if the sequences of the dataset were laid end to end
+         *
+         * @return uint64_t
+         */
+        uint64_t getOffset(size_t) const;
+
+        /**
+         * @brief Get the GC content of a row as a percentage
+         *
+         * @return float
+         */
+        float getGCContent(size_t) const;
+
+        /**
+         * @brief Get the content hash of a row (the one the strand store interns by)
+         *
+         * @return uint64_t
+         */
+        uint64_t getHash(size_t) const;
+
+        /**
+         * @brief Get the number of complete codons of a row
+         *
+         * @return uint32_t
+         */
+        uint32_t getCodonCount(size_t) const;
+
+        /**
+         * @brief Get the number of stop codons of a row
+         *
+         * @return uint32_t
+         */
+        uint32_t getStopCount(size_t) const;
+
+        /**
+         * @brief Get the values of a column as one contiguous array indexed by row, of the type its
+         * getter returns (int32_t for the class)
+         *
+         * @return const void*
+         */
+        const void* getColumnData(Column) const;
+
+        /**
+         * @brief Get the rows matching every predicate in ascending order, testing one column at a time
+         *
+         * @return std::vector<uint32_t>
+         */
+        std::vector<uint32_t> select(const std::vector<Predicate>&) const;
+
+        /**
+         * @brief Sort selected rows by a column, keeping the row order among equal values
+         *
+         */
+        void sortRows(std::vector<uint32_t>&, Column, bool) const;
+
+        /**
+         * @brief Parse a column name (class, length, offset, gc, hash, codons or stops)
+         *
+         * @return bool whether the name is a column
+         */
+        static bool parseColumn(const std::string&, Column&);
+
+        /**
+         * @brief Parse comma separated predicates such as "class=4,length>1000,gc>45"
+         *
+         * @return bool whether every predicate could be parsed
+         */
+        static bool parsePredicates(const std::string&, std::vector<Predicate>&);
+
+    private:
+        size_t _rowCount;
+        // every column is padded past _rowCount to a whole number of filter blocks
+        std::vector<int32_t> _classes;
+        std::vector<uint32_t> _lengths;
+        std::vector<uint64_t> _offsets;
+        std::vector<float> _gcContents;
+        std::vector<uint64_t> _hashes;
+        std::vector<uint32_t> _codonCounts;
+        std::vector<uint32_t> _stopCounts;
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include "TaskScheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const size_t NOT_A_WORKER = (size_t)-1;
+
+    // which scheduler (if any) owns the current thread, so nested submissions stay local
+    thread_local TaskScheduler* currentScheduler = nullptr;
+    thread_local size_t currentWorker = NOT_A_WORKER;
+
+    /**
+     * @brief The chunks of one parallelFor handed out and finished, and the first exception a chunk threw
+     *
+     */
+    struct ParallelLoop {
+        const function<void(size_t, size_t)>* body = nullptr;
+        size_t count = 0;
+        size_t grain = 0;
+        size_t chunkCount = 0;
+        TaskScheduler::Priority priority = TaskScheduler::Priority::Normal;
+        atomic<size_t> nextChunk{0};
+        atomic<size_t> finishedChunks{0};
+        atomic<bool> failed{false};
+        exception_ptr error;
+        mutex finishedMutex;
+        condition_variable finished;
+
+        // claim the next chunk and run it (or skip it once a chunk has thrown); false if every chunk was claimed,
+        // in which case body is not touched as parallelFor may have returned
+        bool runChunk() {
+            size_t chunk = nextChunk++;
+            if (chunk >= chunkCount) {
+                return false;
+            }
+            if (!failed) {
+                size_t start = chunk * grain;
+                size_t end = start + grain < count ? start + grain : count;
+                try {
+                    (*body)(start, end);
+                } catch (...) {
+                    lock_guard<mutex> lock(finishedMutex);
+                    if (!failed) {
+                        error = current_exception();
+                        failed = true;
+                    }
+                }
+            }
+            if (++finishedChunks == chunkCount) {
+                lock_guard<mutex> lock(finishedMutex);
+                finished.notify_all();
+            }
+            return true;
+        }
+    };
+
+    // run one chunk on a worker, then queue the next helper rather than looping, so the worker goes back to
+    // the scheduler between chunks and picks up more urgent tasks first
+    void helpParallelLoop(TaskScheduler& scheduler, const shared_ptr<ParallelLoop>& loop) {
+        if (loop->runChunk() && loop->nextChunk < loop->chunkCount) {
+            scheduler.submit([&scheduler, loop]() { helpParallelLoop(scheduler, loop); }, loop->priority);
+        }
+    }
+}
+
+/**
+ * @brief Construct a new, uncancelled CancelToken
+ *
+ */
+CancelToken::CancelToken() {
+    _cancelled = make_shared<atomic<bool>>(false);
+}
+
+/**
+ * @brief Mark every task holding this token as cancelled
+ *
+ */
+void CancelToken::cancel() const {
+    _cancelled->store(true);
+}
+
+/**
+ * @brief Check whether the token was cancelled
+ *
+ * @return bool
+ */
+bool CancelToken::isCancelled() const {
+    return _cancelled->load();
+}
+
+/**
+ * @brief Construct an empty TaskHandle
+ *
+ */
+TaskHandle::TaskHandle() {
+    _state = make_shared<State>();
+    _state->done = true;
+}
+
+/**
+ * @brief Check whether the task finished running or was dropped after being cancelled
+ *
+ * @return bool
+ */
+bool TaskHandle::isDone() const {
+    lock_guard<mutex> lock(_state->mutex);
+    return _state->done;
+}
+
+/**
+ * @brief Block until the task is done, running other queued tasks meanwhile if called from a worker
+ *
+ */
+void TaskHandle::wait() const {
+    if (currentScheduler != nullptr) {
+        while (!isDone()) {
+            if (!currentScheduler->runPendingTask()) {
+                this_thread::yield();
+            }
+        }
+        return;
+    }
+
+    unique_lock<mutex> lock(_state->mutex);
+    _state->finished.wait(lock, [this]() { return _state->done; });
+}
+
+/**
+ * @brief Cancel the task (and every other task sharing its token)
+ *
+ */
+void TaskHandle::cancel() const {
+    _token.cancel();
+}
+
+/**
+ * @brief Construct a scheduler with the given number of worker threads
+ *
+ */
+TaskScheduler::TaskScheduler(size_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    _queuedCount = 0;
+    _nextQueue = 0;
+    _stopping = false;
+
+    for (size_t i = 0; i < workerCount; i++) {
+        _queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        _workers.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+/**
+ * @brief Finish the queued work and stop the workers
+ *
+ */
+TaskScheduler::~TaskScheduler() {
+    {
+        lock_guard<mutex> lock(_sleepMutex);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+    for (size_t i = 0; i < _workers.size(); i++) {
+        _workers.at(i).join();
+    }
+}
+
+/**
+ * @brief Get the project-wide scheduler (one worker per core, leaving one for the viewer)
+ *
+ * @return TaskScheduler&
+ */
+TaskScheduler& TaskScheduler::shared() {
+    static TaskScheduler scheduler(thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() - 1 : 1);
+    return scheduler;
+}
+
+/**
+ * @brief Get the number of worker threads
+ *
+ * @return size_t
+ */
+size_t TaskScheduler::getWorkerCount() const {
+    return _workers.size();
+}
+
+/**
+ * @brief Queue a task, which is skipped if its token is cancelled before it starts
+ *
+ * @return TaskHandle
+ */
+TaskHandle TaskScheduler::submit(function<void()> function, Priority priority, CancelToken token) {
+    TaskHandle handle;
+    handle._state->done = false;
+    handle._token = token;
+
+    // workers keep their own submissions local (popped newest first); other threads spread them out
+    size_t queue = currentScheduler == this ? currentWorker : _nextQueue++ % _queues.size();
+    _queuedCount++;
+    {
+        lock_guard<mutex> lock(_queues.at(queue)->mutex);
+        _queues.at(queue)->tasks[(size_t)priority].push_back({move(function), handle._state, token, MemoryAccounting::getCurrentTag()});
+    }
+    {
+        lock_guard<mutex> lock(_sleepMutex);
+    }
+    _wakeUp.notify_one();
+    return handle;
+}
+
+/**
+ * @brief Run body(start, end) over [0, count) in chunks of at most grain items, on the calling
+ * thread and any idle workers (which take one chunk per task, so more urgent tasks get in between),
+ * returning once every chunk is done. If body throws, no further chunks start and the first exception
+ * is rethrown once the running ones finish
+ *
+ */
+void TaskScheduler::parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body, Priority priority) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    shared_ptr<ParallelLoop> loop = make_shared<ParallelLoop>();
+    loop->body = &body;
+    loop->count = count;
+    loop->grain = grain;
+    loop->chunkCount = (count + grain - 1) / grain;
+    loop->priority = priority;
+
+    size_t helpers = loop->chunkCount - 1 < _workers.size() ? loop->chunkCount - 1 : _workers.size();
+    for (size_t i = 0; i < helpers; i++) {
+        submit([this, loop]() { helpParallelLoop(*this, loop); }, priority);
+    }
+    while (loop->runChunk()) {
+    }
+
+    // chunks claimed by helpers may still be running body
+    if (currentScheduler != nullptr) {
+        while (loop->finishedChunks < loop->chunkCount) {
+            if (!currentScheduler->runPendingTask()) {
+                this_thread::yield();
+            }
+        }
+    } else {
+        unique_lock<mutex> lock(loop->finishedMutex);
+        loop->finished.wait(lock, [&loop]() { return loop->finishedChunks == loop->chunkCount; });
+    }
+    if (loop->error != nullptr) {
+        rethrow_exception(loop->error);
+    }
+}
+
+/**
+ * @brief Run one queued task on the calling thread if there is one
+ *
+ * @return bool whether a task was run
+ */
+bool TaskScheduler::runPendingTask() {
+    Task task;
+    if (!takeTask(currentScheduler == this ? currentWorker : NOT_A_WORKER, task)) {
+        return false;
+    }
+    runTask(task);
+    return true;
+}
+
+/**
+ * @brief Main loop of each worker thread
+ *
+ */
+void TaskScheduler::workerLoop(size_t worker) {
+    currentScheduler = this;
+    currentWorker = worker;
+
+    while (true) {
+        Task task;
+        if (takeTask(worker, task)) {
+            runTask(task);
+            continue;
+        }
+
+        unique_lock<mutex> lock(_sleepMutex);
+        _wakeUp.wait(lock, [this]() { return _stopping || _queuedCount > 0; });
+        if (_stopping && _queuedCount == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Take the most urgent task, preferring the given worker's own queue
+ *
+ * @return bool whether a task was found
+ */
+bool TaskScheduler::takeTask(size_t worker, Task& task) {
+    for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        if (worker != NOT_A_WORKER) {
+            WorkerQueue& own = *_queues.at(worker);
+            lock_guard<mutex> lock(own.mutex);
+            if (!own.tasks[priority].empty()) {
+                task = move(own.tasks[priority].back());
+                own.tasks[priority].pop_back();
+                _queuedCount--;
+                return true;
+            }
+        }
+
+        // steal the oldest task of this priority from the other workers
+        size_t start = worker == NOT_A_WORKER ? 0 : worker + 1;
+        for (size_t i = 0; i < _queues.size(); i++) {
+            size_t victim = (start + i) % _queues.size();
+            if (victim == worker) {
+                continue;
+            }
+            WorkerQueue& other = *_queues.at(victim);
+            lock_guard<mutex> lock(other.mutex);
+            if (!other.tasks[priority].empty()) {
+                task = move(other.tasks[priority].front());
+                other.tasks[priority].pop_front();
+                _queuedCount--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Run a task (or drop it if cancelled) and mark it done
+ *
+ */
+void TaskScheduler::runTask(Task& task) {
+    {
+        MemoryScope scope(task.tag);
+        if (!task.token.isCancelled()) {
+            task.function();
+        }
+        // release whatever the task captured before anyone waiting on it wakes up
+        task.function = nullptr;
+    }
+
+    lock_guard<mutex> lock(task.state->mutex);
+    task.state->done = true;
+    task.state->finished.notify_all();
+}
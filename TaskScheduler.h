@@ -0,0 +1,223 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "MemoryAccounting.h"
+
+/**
+ * @brief Shared flag that tells queued and running tasks their result is no longer wanted
+ *
+ */
+class CancelToken {
+    public:
+        /**
+         * @brief Construct a new, uncancelled CancelToken
+         *
+         */
+        CancelToken();
+
+        /**
+         * @brief Mark every task holding this token as cancelled
+         *
+         */
+        void cancel() const;
+
+        /**
+         * @brief Check whether the token was cancelled
+         *
+         * @return bool
+         */
+        bool isCancelled() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool>> _cancelled;
+};
+
+/**
+ * @brief Handle to a submitted task that can be waited on or cancelled
+ *
+ */
+class TaskHandle {
+    public:
+        /**
+         * @brief Construct an empty TaskHandle
+         *
+         */
+        TaskHandle();
+
+        /**
+         * @brief Check whether the task finished running or was dropped after being cancelled
+         *
+         * @return bool
+         */
+        bool isDone() const;
+
+        /**
+         * @brief Block until the task is done, running other queued tasks meanwhile if called from a worker
+         *
+         */
+        void wait() const;
+
+        /**
+         * @brief Cancel the task (and every other task sharing its token)
+         *
+         */
+        void cancel() const;
+
+    private:
+        friend class TaskScheduler;
+
+        struct State {
+            std::mutex mutex;
+            std::condition_variable finished;
+            bool done = false;
+        };
+
+        std::shared_ptr<State> _state;
+        CancelToken _token;
+};
+
+class TaskScheduler {
+    public:
+        /**
+         * @brief Order in which queued tasks are picked; every worker always takes the most urgent task available
+         *
+         */
+        enum class Priority { Interactive = 0, Normal = 1, Batch = 2 };
+
+        /**
+         * @brief Construct a scheduler with the given number of worker threads
+         *
+         */
+        explicit TaskScheduler(size_t);
+
+        /**
+         * @brief Finish the queued work and stop the workers
+         *
+         */
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        /**
+         * @brief Get the project-wide scheduler (one worker per core, leaving one for the viewer)
+         *
+         * @return TaskScheduler&
+         */
+        static TaskScheduler& shared();
+
+        /**
+         * @brief Get the number of worker threads
+         *
+         * @return size_t
+         */
+        size_t getWorkerCount() const;
+
+        /**
+         * @brief Queue a task, which is skipped if its token is cancelled before it starts
+         *
+         * @return TaskHandle
+         */
+        TaskHandle submit(std::function<void()>, Priority = Priority::Normal, CancelToken = CancelToken());
+
+        /**
+         * @brief Queue a task and get its result through a future; a cancelled task leaves the future broken
+         *
+         */
+        template <class Function>
+        std::future<typename std::invoke_result<Function>::type> async(Function function, Priority priority = Priority::Normal, CancelToken token = CancelToken()) {
+            using Result = typename std::invoke_result<Function>::type;
+            std::shared_ptr<std::promise<Result>> promise = std::make_shared<std::promise<Result>>();
+            std::future<Result> result = promise->get_future();
+            submit([promise, function]() mutable {
+                try {
+                    if constexpr (std::is_void<Result>::value) {
+                        function();
+                        promise->set_value();
+                    } else {
+                        promise->set_value(function());
+                    }
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            }, priority, token);
+            return result;
+        }
+
+        /**
+         * @brief Run body(start, end) over [0, count) in chunks of at most grain items, on the calling
+         * thread and any idle workers (which take one chunk per task, so more urgent tasks get in between),
+         * returning once every chunk is done. If body throws, no further chunks start and the first exception
+         * is rethrown once the running ones finish
+         *
+         */
+        void parallelFor(size_t, size_t, const std::function<void(size_t, size_t)>&, Priority = Priority::Normal);
+
+        /**
+         * @brief Run one queued task on the calling thread if there is one
+         *
+         * @return bool whether a task was run
+         */
+        bool runPendingTask();
+
+    private:
+        struct Task {
+            std::function<void()> function;
+            std::shared_ptr<TaskHandle::State> state;
+            CancelToken token;
+            // allocations of the task are charged where it was submitted
+            MemoryTag tag = MemoryTag::Other;
+        };
+
+        static const size_t PRIORITY_COUNT = 3;
+
+        /**
+         * @brief Per worker queues, one per priority; the owner pops from the back and thieves from the front
+         *
+         */
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks[PRIORITY_COUNT];
+        };
+
+        /**
+         * @brief Main loop of each worker thread
+         *
+         */
+        void workerLoop(size_t);
+
+        /**
+         * @brief Take the most urgent task, preferring the given worker's own queue
+         *
+         * @return bool whether a task was found
+         */
+        bool takeTask(size_t, Task&);
+
+        /**
+         * @brief Run a task (or drop it if cancelled) and mark it done
+         *
+         */
+        static void runTask(Task&);
+
+        std::vector<std::unique_ptr<WorkerQueue>> _queues;
+        std::vector<std::thread> _workers;
+        std::atomic<size_t> _queuedCount;
+        std::atomic<size_t> _nextQueue;
+        std::mutex _sleepMutex;
+        std::condition_variable _wakeUp;
+        bool _stopping;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "analysis_kernels.h"
+#include "Protein.h"
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief The amino acid number of every codon of the table, and the codon table digit of every character
+     * (U, C, A, G order) for each nucleotide alphabet
+     *
+     */
+    struct CodonTables {
+        uint8_t aminoAcid[64];
+        uint8_t dnaDigit[256];
+        uint8_t rnaDigit[256];
+
+        CodonTables() {
+            map<string, uint8_t> numbers;
+            for (int i = 0; i < 64; i++) {
+                string name = Protein::getProteinName(i);
+                if (numbers.count(name) == 0) {
+                    uint8_t number = (uint8_t)numbers.size();
+                    numbers[name] = number;
+                }
+                aminoAcid[i] = numbers[name];
+            }
+
+            for (int i = 0; i < 256; i++) {
+                dnaDigit[i] = 4;
+                rnaDigit[i] = 4;
+            }
+            dnaDigit['T'] = rnaDigit['U'] = 0;
+            dnaDigit['C'] = rnaDigit['C'] = 1;
+            dnaDigit['A'] = rnaDigit['A'] = 2;
+            dnaDigit['G'] = rnaDigit['G'] = 3;
+        }
+    };
+
+    const CodonTables& codonTables() {
+        static const CodonTables tables;
+        return tables;
+    }
+
+    /**
+     * @brief Pick the window counter compiled for the width, or nullptr if there is none
+     *
+     */
+    template <Alphabet A, Encoding E>
+    void (*findWindowKernel(size_t width))(const uint8_t*, const uint8_t*, size_t, uint32_t*) {
+        if (width == CLUSTER_WIDTH) {
+            return countWindowMatches<A, E, CLUSTER_WIDTH>;
+        }
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Translate a DNA or RNA sequence into amino acid numbers, one per codon (a partial last codon, or one
+ * with any other character, gives UNKNOWN_AMINO_ACID), written into a buffer of (length + 2) / 3 bytes
+ *
+ */
+template <Alphabet A>
+void translateCodons(const char* bases, size_t length, uint8_t* aminoAcids) {
+    findCodons<A>(bases, length, aminoAcids);
+    const CodonTables& tables = codonTables();
+    size_t codons = (length + CODON_LENGTH - 1) / CODON_LENGTH;
+    for (size_t i = 0; i < codons; i++) {
+        aminoAcids[i] = aminoAcids[i] == UNKNOWN_CODON ? UNKNOWN_AMINO_ACID : tables.aminoAcid[aminoAcids[i]];
+    }
+}
+
+/**
+ * @brief Write the codon table index (U, C, A, G order, see Protein::findCodonIndex) of every codon of a DNA or RNA
+ * sequence into a buffer of (length + 2) / 3 bytes; a partial last codon, or one with any other character,
+ * gives UNKNOWN_CODON
+ *
+ */
+template <Alphabet A>
+void findCodons(const char* bases, size_t length, uint8_t* codons) {
+    static_assert(A != Alphabet::AminoAcid, "only nucleotides form codons");
+    const CodonTables& tables = codonTables();
+    const uint8_t* digit = A == Alphabet::DNA ? tables.dnaDigit : tables.rnaDigit;
+    size_t complete = length / CODON_LENGTH;
+    for (size_t i = 0; i < complete; i++) {
+        const uint8_t* codon = (const uint8_t*)bases + i * CODON_LENGTH;
+        unsigned first = digit[codon[0]];
+        unsigned second = digit[codon[1]];
+        unsigned third = digit[codon[2]];
+        codons[i] = (first | second | third) > 3 ? UNKNOWN_CODON : (uint8_t)(first * 16 + second * 4 + third);
+    }
+    if (length % CODON_LENGTH != 0) {
+        codons[complete] = UNKNOWN_CODON;
+    }
+}
+
+/**
+ * @brief Get the amino acid number of an entry of the codon table, numbered in the order the protein
+ * names first appear in it
+ *
+ * @return uint8_t
+ */
+uint8_t getAminoAcid(int codonIndex) {
+    return codonIndex < 0 || codonIndex >= 64 ? UNKNOWN_AMINO_ACID : codonTables().aminoAcid[codonIndex];
+}
+
+/**
+ * @brief Count the matching symbols of the first length positions of two sequences, with the kernel
+ * compiled for the alphabet and encoding
+ *
+ * @return size_t
+ */
+size_t countMatches(Alphabet alphabet, Encoding encoding, const uint8_t* first, const uint8_t* second, size_t length) {
+    if (alphabet == Alphabet::AminoAcid) {
+        return countMatches<Alphabet::AminoAcid, Encoding::Byte>(first, second, length);
+    }
+    // the two nucleotide alphabets only differ in translation
+    if (encoding == Encoding::Packed) {
+        return countMatches<Alphabet::DNA, Encoding::Packed>(first, second, length);
+    }
+    return countMatches<Alphabet::DNA, Encoding::Byte>(first, second, length);
+}
+
+/**
+ * @brief Count the matching symbols of each window of the given width, with a kernel compiled for the
+ * alphabet, encoding and width when there is one and countWindowMatchesGeneric otherwise
+ *
+ */
+void countWindowMatches(Alphabet alphabet, Encoding encoding, size_t width, const uint8_t* first, const uint8_t* second, size_t windows, uint32_t* counts) {
+    void (*kernel)(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+    if (alphabet == Alphabet::AminoAcid) {
+        kernel = findWindowKernel<Alphabet::AminoAcid, Encoding::Byte>(width);
+    } else if (encoding == Encoding::Packed) {
+        kernel = findWindowKernel<Alphabet::DNA, Encoding::Packed>(width);
+    } else {
+        kernel = findWindowKernel<Alphabet::DNA, Encoding::Byte>(width);
+    }
+    if (kernel != nullptr) {
+        kernel(first, second, windows, counts);
+    } else if (alphabet == Alphabet::AminoAcid) {
+        countWindowMatchesGeneric<Alphabet::AminoAcid, Encoding::Byte>(width, first, second, windows, counts);
+    } else if (encoding == Encoding::Packed) {
+        countWindowMatchesGeneric<Alphabet::DNA, Encoding::Packed>(width, first, second, windows, counts);
+    } else {
+        countWindowMatchesGeneric<Alphabet::DNA, Encoding::Byte>(width, first, second, windows, counts);
+    }
+}
+
+/**
+ * @brief Find the CLUSTER_COUNT windows of the given width (of the given number of windows) with the most
+ * matching symbols, at least a width apart. The search starts from the windows firstStride apart (1 apart if
+ * they do not fit) and replaces the first of the weakest with each later, stronger window that is far enough
+ * from all of them; with fewer windows than CLUSTER_COUNT it gives all of them
+ *
+ * @return std::vector<int> window start positions
+ */
+vector<int> findClusterWindows(Alphabet alphabet, Encoding encoding, size_t width, size_t windows, const uint8_t* first, const uint8_t* second, size_t firstStride) {
+    vector<uint32_t> counts(windows);
+    if (windows >= CLUSTER_COUNT) {
+        countWindowMatches(alphabet, encoding, width, first, second, windows, counts.data());
+    }
+    return findClusterWindows(counts.data(), windows, width, firstStride);
+}
+
+/**
+ * @brief findClusterWindows over match counts already found for each of the given number of windows
+ * of the given width, such as MatchIndex window counts
+ *
+ * @return std::vector<int> window start positions
+ */
+vector<int> findClusterWindows(const uint32_t* counts, size_t windows, size_t width, size_t firstStride) {
+    vector<int> topClusters;
+    if (windows < CLUSTER_COUNT) {
+        for (size_t i = 0; i < windows; i++) {
+            topClusters.push_back((int)i);
+        }
+        return topClusters;
+    }
+
+    if ((CLUSTER_COUNT - 1) * firstStride >= windows) {
+        firstStride = 1;
+    }
+    for (size_t k = 0; k < CLUSTER_COUNT; k++) {
+        topClusters.push_back((int)(k * firstStride));
+    }
+    size_t currMin = 0;
+    for (size_t k = 1; k < CLUSTER_COUNT; k++) {
+        if (counts[topClusters[k]] < counts[topClusters[currMin]]) {
+            currMin = k;
+        }
+    }
+
+    for (size_t i = CLUSTER_COUNT; i < windows; i++) {
+        if (counts[i] <= counts[topClusters[currMin]]) {
+            continue;
+        }
+        // only add unique clusters
+        bool isUnique = true;
+        for (size_t k = 0; k < CLUSTER_COUNT && isUnique; k++) {
+            size_t position = (size_t)topClusters[k];
+            isUnique = (i > position ? i - position : position - i) >= width;
+        }
+        if (isUnique) {
+            topClusters[currMin] = (int)i;
+            currMin = 0;
+            for (size_t k = 1; k < CLUSTER_COUNT; k++) {
+                if (counts[topClusters[k]] < counts[topClusters[currMin]]) {
+                    currMin = k;
+                }
+            }
+        }
+    }
+    return topClusters;
+}
+
+template void translateCodons<Alphabet::DNA>(const char*, size_t, uint8_t*);
+template void translateCodons<Alphabet::RNA>(const char*, size_t, uint8_t*);
+template void findCodons<Alphabet::DNA>(const char*, size_t, uint8_t*);
+template void findCodons<Alphabet::RNA>(const char*, size_t, uint8_t*);
+
+template size_t countMatches<Alphabet::DNA, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+template size_t countMatches<Alphabet::DNA, Encoding::Packed>(const uint8_t*, const uint8_t*, size_t);
+template size_t countMatches<Alphabet::RNA, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+template size_t countMatches<Alphabet::RNA, Encoding::Packed>(const uint8_t*, const uint8_t*, size_t);
+template size_t countMatches<Alphabet::AminoAcid, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+
+template void countWindowMatches<Alphabet::DNA, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+template void countWindowMatches<Alphabet::DNA, Encoding::Packed, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+template void countWindowMatches<Alphabet::RNA, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+template void countWindowMatches<Alphabet::RNA, Encoding::Packed, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+template void countWindowMatches<Alphabet::AminoAcid, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
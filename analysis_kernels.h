@@ -0,0 +1,187 @@
+#ifndef ANALYSIS_KERNELS_H
+#define ANALYSIS_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The symbols a sequence is made of
+ *
+ */
+enum class Alphabet { DNA, RNA, AminoAcid };
+
+/**
+ * @brief How the symbols are stored: a byte each (characters, or amino acid numbers from translateCodons),
+ * or 2 bits per base as packNucleotides writes them
+ *
+ */
+enum class Encoding { Byte, Packed };
+
+// nucleotides per codon
+const size_t CODON_LENGTH = 3;
+// symbols per similarity window, and the number of windows a cluster search keeps
+const size_t CLUSTER_WIDTH = 5;
+const size_t CLUSTER_COUNT = 5;
+// the codon table index of anything that is not a codon of the table
+const uint8_t UNKNOWN_CODON = 0xFF;
+// the amino acid number of anything that is not a codon of the table (Protein::findProtein gives "?"), which never matches
+const uint8_t UNKNOWN_AMINO_ACID = 0xFF;
+
+/**
+ * @brief Whether the symbols at a position of two sequences match. Characters match when they are equal
+ * (case and all), packed bases when their codes are, amino acids when they are the same known one
+ *
+ */
+template <Alphabet A, Encoding E>
+struct SymbolMatch {
+    static_assert(E == Encoding::Byte, "amino acids are only stored a byte each");
+
+    static bool at(const uint8_t* first, const uint8_t* second, size_t i) {
+        if (A == Alphabet::AminoAcid) {
+            return first[i] == second[i] && first[i] != UNKNOWN_AMINO_ACID;
+        }
+        return first[i] == second[i];
+    }
+};
+
+template <>
+struct SymbolMatch<Alphabet::DNA, Encoding::Packed> {
+    static bool at(const uint8_t* first, const uint8_t* second, size_t i) {
+        return (((first[i >> 2] ^ second[i >> 2]) >> (2 * (i & 3))) & 3) == 0;
+    }
+};
+
+template <>
+struct SymbolMatch<Alphabet::RNA, Encoding::Packed> : SymbolMatch<Alphabet::DNA, Encoding::Packed> {
+};
+
+/**
+ * @brief Count the matching symbols of the first length positions of two sequences
+ *
+ * @return size_t
+ */
+template <Alphabet A, Encoding E>
+size_t countMatches(const uint8_t* first, const uint8_t* second, size_t length) {
+    size_t matches = 0;
+    for (size_t i = 0; i < length; i++) {
+        matches += SymbolMatch<A, E>::at(first, second, i);
+    }
+    return matches;
+}
+
+/**
+ * @brief Count the matching symbols of each of the given number of windows of Width symbols
+ * (window i starts at symbol i); the window loop is unrolled since its length is known
+ *
+ */
+template <Alphabet A, Encoding E, size_t Width>
+void countWindowMatches(const uint8_t* first, const uint8_t* second, size_t windows, uint32_t* counts) {
+    static_assert(Width > 0, "windows hold at least one symbol");
+    for (size_t i = 0; i < windows; i++) {
+        uint32_t matches = 0;
+        for (size_t j = 0; j < Width; j++) {
+            matches += SymbolMatch<A, E>::at(first, second, i + j);
+        }
+        counts[i] = matches;
+    }
+}
+
+/**
+ * @brief Count the matching symbols of each of the given number of windows of any width, keeping a running
+ * count so wide windows cost no more than narrow ones
+ *
+ */
+template <Alphabet A, Encoding E>
+void countWindowMatchesGeneric(size_t width, const uint8_t* first, const uint8_t* second, size_t windows, uint32_t* counts) {
+    if (windows == 0) {
+        return;
+    }
+    uint32_t matches = 0;
+    for (size_t j = 0; j < width; j++) {
+        matches += SymbolMatch<A, E>::at(first, second, j);
+    }
+    counts[0] = matches;
+    for (size_t i = 1; i < windows; i++) {
+        matches += SymbolMatch<A, E>::at(first, second, i + width - 1);
+        matches -= SymbolMatch<A, E>::at(first, second, i - 1);
+        counts[i] = matches;
+    }
+}
+
+/**
+ * @brief Translate a DNA or RNA sequence into amino acid numbers, one per codon (a partial last codon, or one
+ * with any other character, gives UNKNOWN_AMINO_ACID), written into a buffer of (length + 2) / 3 bytes
+ *
+ */
+template <Alphabet A>
+void translateCodons(const char* bases, size_t length, uint8_t* aminoAcids);
+
+/**
+ * @brief Write the codon table index (U, C, A, G order, see Protein::findCodonIndex) of every codon of a DNA or RNA
+ * sequence into a buffer of (length + 2) / 3 bytes; a partial last codon, or one with any other character,
+ * gives UNKNOWN_CODON
+ *
+ */
+template <Alphabet A>
+void findCodons(const char* bases, size_t length, uint8_t* codons);
+
+/**
+ * @brief Get the amino acid number of an entry of the codon table, numbered in the order the protein
+ * names first appear in it
+ *
+ * @return uint8_t
+ */
+uint8_t getAminoAcid(int);
+
+/**
+ * @brief Count the matching symbols of the first length positions of two sequences, with the kernel
+ * compiled for the alphabet and encoding
+ *
+ * @return size_t
+ */
+size_t countMatches(Alphabet, Encoding, const uint8_t*, const uint8_t*, size_t);
+
+/**
+ * @brief Count the matching symbols of each window of the given width, with a kernel compiled for the
+ * alphabet, encoding and width when there is one and countWindowMatchesGeneric otherwise
+ *
+ */
+void countWindowMatches(Alphabet, Encoding, size_t, const uint8_t*, const uint8_t*, size_t, uint32_t*);
+
+/**
+ * @brief Find the CLUSTER_COUNT windows of the given width (of the given number of windows) with the most
+ * matching symbols, at least a width apart. The search starts from the windows firstStride apart (1 apart if
+ * they do not fit) and replaces the first of the weakest with each later, stronger window that is far enough
+ * from all of them; with fewer windows than CLUSTER_COUNT it gives all of them
+ *
+ * @return std::vector<int> window start positions
+ */
+std::vector<int> findClusterWindows(Alphabet, Encoding, size_t, size_t, const uint8_t*, const uint8_t*, size_t);
+
+/**
+ * @brief findClusterWindows over match counts already found for each of the given number of windows
+ * of the given width, such as MatchIndex window counts
+ *
+ * @return std::vector<int> window start positions
+ */
+std::vector<int> findClusterWindows(const uint32_t*, size_t, size_t, size_t);
+
+extern template void translateCodons<Alphabet::DNA>(const char*, size_t, uint8_t*);
+extern template void translateCodons<Alphabet::RNA>(const char*, size_t, uint8_t*);
+extern template void findCodons<Alphabet::DNA>(const char*, size_t, uint8_t*);
+extern template void findCodons<Alphabet::RNA>(const char*, size_t, uint8_t*);
+
+extern template size_t countMatches<Alphabet::DNA, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+extern template size_t countMatches<Alphabet::DNA, Encoding::Packed>(const uint8_t*, const uint8_t*, size_t);
+extern template size_t countMatches<Alphabet::RNA, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+extern template size_t countMatches<Alphabet::RNA, Encoding::Packed>(const uint8_t*, const uint8_t*, size_t);
+extern template size_t countMatches<Alphabet::AminoAcid, Encoding::Byte>(const uint8_t*, const uint8_t*, size_t);
+
+extern template void countWindowMatches<Alphabet::DNA, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+extern template void countWindowMatches<Alphabet::DNA, Encoding::Packed, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+extern template void countWindowMatches<Alphabet::RNA, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+extern template void countWindowMatches<Alphabet::RNA, Encoding::Packed, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+extern template void countWindowMatches<Alphabet::AminoAcid, Encoding::Byte, CLUSTER_WIDTH>(const uint8_t*, const uint8_t*, size_t, uint32_t*);
+
+#endif
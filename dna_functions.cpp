@@ -1,4 +1,6 @@
 #include "dna_functions.h"
+#include "sequence_kernels.h"
+#include <cstring>
 
 using namespace std;
 
@@ -23,4 +25,67 @@ size_t getMin(vector<double> vals, vector<int> indexes) {
         }
     }
     return min;
-}
\ No newline at end of file
+}
+
+uint64_t hashSequence(string_view sequence) {
+    return hashBytes(sequence.data(), sequence.size());
+}
+
+uint64_t hashBytes(const void* data, size_t size) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    const char* bytes = (const char*)data;
+    uint64_t hash = 0x243F6A8885A308D3ull ^ ((uint64_t)size * multiplier);
+
+    // mix in 8 bytes at a time, then the tail
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, size - i);
+    hash = (hash ^ tail) * multiplier;
+
+    // final avalanche so nearby sequences land far apart
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+vector<OpenReadingFrame> findOpenReadingFrames(string_view sequence, size_t minimumCodons) {
+    vector<OpenReadingFrame> frames;
+    size_t length = sequence.size();
+    string reverse(length, ' ');
+    reverseComplement(sequence.data(), reverse.data(), length);
+    string forward(length, ' ');
+    toUpperCase(sequence.data(), forward.data(), length);
+
+    for (int strand = 0; strand < 2; strand++) {
+        const string& bases = strand == 0 ? forward : reverse;
+        for (size_t offset = 0; offset < 3; offset++) {
+            bool open = false;
+            size_t start = 0;
+            for (size_t i = offset; i + 3 <= length; i += 3) {
+                const char* codon = bases.data() + i;
+                if (!open && codon[0] == 'A' && codon[1] == 'T' && codon[2] == 'G') {
+                    open = true;
+                    start = i;
+                } else if (open && codon[0] == 'T' && ((codon[1] == 'A' && (codon[2] == 'A' || codon[2] == 'G')) || (codon[1] == 'G' && codon[2] == 'A'))) {
+                    open = false;
+                    if ((i + 3 - start) / 3 < minimumCodons) {
+                        continue;
+                    }
+                    OpenReadingFrame frame;
+                    frame.start = (uint32_t)(strand == 0 ? start : length - (i + 3));
+                    frame.end = (uint32_t)(strand == 0 ? i + 3 : length - start);
+                    frame.frame = (int8_t)(strand == 0 ? (int)offset + 1 : -((int)offset + 1));
+                    frames.push_back(frame);
+                }
+            }
+        }
+    }
+    return frames;
+}
@@ -1,6 +1,10 @@
 #ifndef DNA_FUNCTIONS_H
 #define DNA_FUNCTIONS_H
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -17,4 +21,38 @@ char getPair(char);
  */
 size_t getMin(std::vector<double>, std::vector<int>);
 
+/**
+ * @brief Get a fast 64-bit content hash of a sequence (not cryptographic, equal sequences give equal hashes)
+ * 
+ * @return uint64_t 
+ */
+uint64_t hashSequence(std::string_view);
+
+/**
+ * @brief Get the same 64-bit hash as hashSequence for any block of bytes
+ * 
+ * @return uint64_t 
+ */
+uint64_t hashBytes(const void*, size_t);
+
+/**
+ * @brief A start codon (ATG) and the codons after it up to and including the first stop codon in the same frame
+ * 
+ */
+struct OpenReadingFrame {
+    // bases [start, end) of the forward sequence, whichever strand the frame reads
+    uint32_t start;
+    uint32_t end;
+    // 1 to 3 reading the sequence from its first to third base, -1 to -3 reading its reverse complement
+    int8_t frame;
+};
+
+/**
+ * @brief Find the open reading frames of at least the given number of codons in all six frames,
+ * starting each at the first ATG after the previous stop
+ * 
+ * @return std::vector<OpenReadingFrame> 
+ */
+std::vector<OpenReadingFrame> findOpenReadingFrames(std::string_view, size_t);
+
 #endif
\ No newline at end of file
@@ -7,46 +7,377 @@
  * Pulls DNA data from input files and create a visual analyzer to view similarities and clusters along strands
  * Press up and down arrows to navigate between strands
  * Press left and right arrows to scroll a singular strand
+ * Press +/- (or use the mouse wheel) to zoom the overview tracks and click them to jump
+ * Press tab (shift+tab) to change the second (first) species being compared
+ * Press S to show composition, codon usage and amino acid statistics of both species
+ * Press M to show how much memory each part of the program is using instead
+ * The viewer only redraws when something changes and sleeps while waiting for input
+ *
+ * Usage: FP [--matrix] [--stats <file.tsv>] [--mutate <replicates> [--rate <per base>] [--seed <n>]] [--cache <file> | --no-cache] [--serve <socket>] [--export <prefix>] [--memory] [--filter <predicates>] [--sort [-]<column>] [--fps <n>] [--vsync] [species...]
+ * Any number of species from datasets/<species>.txt can be loaded; identical strands are shared between them.
+ * --matrix prints the average similarity of every pair of species instead of opening the viewer
+ * --stats writes per species, class and strand statistics as a tab separated table (- for stdout) instead of opening the viewer
+ * --mutate applies random SNPs and indels to every strand the given number of times and reports the effect on protein similarity
+ * Comparison results are kept in datasets/results.cache (or the --cache file) and reused by later runs; --no-cache turns this off
+ * --export writes per strand statistics and open reading frames and per strand pair comparisons and clusters as Arrow
+ *   files (<prefix>.strands.arrow, <prefix>.orfs.arrow, <prefix>.pairs.arrow) for notebooks instead of opening the viewer
+ * --memory prints the memory used by sequences, codons, proteins, loaders, indexes, caches and the rest, and the size of each
+ *   species' strand arena, once a headless run is done
+ * --filter limits the viewer, --matrix, --mutate and --export to the strands matching every predicate, e.g. "class=4,length>1000,gc>45"
+ *   (columns: class, length, offset, gc, hash, codons, stops); --sort orders them by a column, descending with a leading -
+ * --serve keeps the datasets loaded and answers compare, cluster, search and statistics queries on a Unix socket until interrupted
+ * --fps limits the frame rate while scrolling (60 by default, 0 for no limit) and --vsync syncs frames to the display instead
 */
 
+#include "ComparisonServer.h"
+#include "Dataset.h"
 #include "DNAStrand.h"
+#include "EditDistance.h"
+#include "MatchIndex.h"
+#include "MemoryAccounting.h"
+#include "MutationSimulator.h"
+#include "OverviewTrack.h"
 #include "Protein.h"
+#include "ResultCache.h"
+#include "ResultExporter.h"
+#include "Statistics.h"
+#include "StrandArena.h"
+#include "StrandStore.h"
+#include "StrandTable.h"
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <csignal>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 using namespace std;
 
-vector<DNAStrand> readFile(string animalName) {
-    ifstream fin("datasets/"+ animalName + ".txt");
-    // check if there is an error
-    if (fin.fail()) {
-        cerr <<  "Error opening \'" + animalName + ".txt\' file";
-        return {};
+// comparison data for one strand pair, computed off the main thread
+struct StrandComparison {
+    MatchIndex matchIndex;
+    vector<int> similarityClusters;
+    vector<int> similarityClustersP;
+    int editDistance = 0;
+};
+
+// a finished comparison kept for when the user comes back to the pair; holding the strands keeps their addresses
+// from being reused by other strands
+struct CachedComparison {
+    shared_ptr<const DNAStrand> first;
+    shared_ptr<const DNAStrand> second;
+    StrandComparison comparison;
+};
+
+// comparisons kept at most, each holding a match index as large as its strands
+const size_t COMPARISON_CACHE_SIZE = 16;
+
+// which strands to look at and in which order
+struct StrandSelection {
+    vector<StrandTable::Predicate> predicates;
+    bool sorted = false;
+    StrandTable::Column sortColumn = StrandTable::Column::Class;
+    bool descending = false;
+
+    bool isActive() const {
+        return !predicates.empty() || sorted;
+    }
+};
+
+bool datasetExists(const string& animalName) {
+    ifstream fin("datasets/" + animalName + ".txt");
+    return !fin.fail();
+}
+
+// strands loaded in both datasets that match the selection in both, in the selection's order
+vector<uint32_t> selectSharedStrands(const Dataset& first, const Dataset& second, const StrandSelection& selection) {
+    vector<uint32_t> firstRows = first.getTable().select(selection.predicates);
+    vector<uint32_t> secondRows = second.getTable().select(selection.predicates);
+    vector<uint32_t> rows;
+    set_intersection(firstRows.begin(), firstRows.end(), secondRows.begin(), secondRows.end(), back_inserter(rows));
+    if (selection.sorted) {
+        first.getTable().sortRows(rows, selection.sortColumn, selection.descending);
+    }
+    return rows;
+}
+
+// print the average nucleotide similarity, protein similarity and edit distance over the shared strands of every pair of species
+void printSimilarityMatrix(const vector<unique_ptr<Dataset>>& datasets, const StrandSelection& selection) {
+    for (size_t i = 0; i < datasets.size(); i++) {
+        datasets.at(i)->waitUntilLoaded();
+    }
+
+    cout << left << setw(24) << "species pair" << setw(10) << "strands" << setw(14) << "nucleotide %" << setw(14) << "protein %" << "edit distance" << endl;
+    for (size_t i = 0; i < datasets.size(); i++) {
+        for (size_t j = i + 1; j < datasets.size(); j++) {
+            const Dataset& first = *datasets.at(i);
+            const Dataset& second = *datasets.at(j);
+            vector<uint32_t> rows = selectSharedStrands(first, second, selection);
+            size_t end = rows.size();
+
+            // interned strands make repeated pairs (across species pairs too) a memo lookup
+            vector<double> nucleotide(end);
+            vector<double> protein(end);
+            vector<int> distance(end);
+            TaskScheduler::shared().parallelFor(end, 16, [&](size_t start, size_t stop) {
+                for (size_t k = start; k < stop; k++) {
+                    shared_ptr<const DNAStrand> firstStrand = first.getStrand(rows[k]);
+                    shared_ptr<const DNAStrand> secondStrand = second.getStrand(rows[k]);
+                    nucleotide[k] = StrandStore::shared().compareDNA(firstStrand, secondStrand);
+                    protein[k] = StrandStore::shared().compareProteins(firstStrand, secondStrand);
+                    distance[k] = StrandStore::shared().editDistance(firstStrand, secondStrand);
+                }
+            }, TaskScheduler::Priority::Batch);
+
+            double nucleotideTotal = 0;
+            double proteinTotal = 0;
+            double distanceTotal = 0;
+            for (size_t k = 0; k < end; k++) {
+                nucleotideTotal += nucleotide[k];
+                proteinTotal += protein[k];
+                distanceTotal += distance[k];
+            }
+            cout << left << setw(24) << first.getName() + " vs " + second.getName() << setw(10) << end
+                 << setw(14) << (end == 0 ? 0 : nucleotideTotal / (double)end) << setw(14) << (end == 0 ? 0 : proteinTotal / (double)end)
+                 << (end == 0 ? 0 : distanceTotal / (double)end) << endl;
+        }
+    }
+    cout << StrandStore::shared().getUniqueCount() << " unique strands out of " << StrandStore::shared().getLookupCount() << " loaded" << endl;
+}
+
+// check the bit-parallel edit distance, full and banded, against the textbook dynamic program on the shared
+// strands of every pair of species
+bool checkEditDistance(const vector<unique_ptr<Dataset>>& datasets, const StrandSelection& selection) {
+    for (size_t i = 0; i < datasets.size(); i++) {
+        datasets.at(i)->waitUntilLoaded();
     }
 
-    string header;
-    fin >> header >> header;
+    size_t checked = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < datasets.size(); i++) {
+        for (size_t j = i + 1; j < datasets.size(); j++) {
+            const Dataset& first = *datasets.at(i);
+            const Dataset& second = *datasets.at(j);
+            vector<uint32_t> rows = selectSharedStrands(first, second, selection);
 
-    vector<DNAStrand> animal;
-    // iterate through the files
-    while(!fin.eof()) {
-        string dnaLine;
-        int classNum;
-        fin >> dnaLine;
-        fin >> classNum;
+            // per pair: the reference distance, then the full, tight band and too narrow band results
+            vector<array<int, 4>> results(rows.size());
+            TaskScheduler::shared().parallelFor(rows.size(), 4, [&](size_t start, size_t stop) {
+                for (size_t k = start; k < stop; k++) {
+                    string_view firstSequence = first.at(rows[k]).getSequence();
+                    string_view secondSequence = second.at(rows[k]).getSequence();
+                    int expected = EditDistance::betweenNaive(firstSequence, secondSequence);
+                    results[k][0] = expected;
+                    results[k][1] = EditDistance::between(firstSequence, secondSequence);
+                    results[k][2] = EditDistance::between(firstSequence, secondSequence, expected);
+                    // a band one short of the distance gives one past it
+                    results[k][3] = expected == 0 ? 0 : EditDistance::between(firstSequence, secondSequence, expected - 1);
+                }
+            }, TaskScheduler::Priority::Batch);
 
-        // create dna strand
-        DNAStrand dna = DNAStrand(animalName, dnaLine, classNum);
-        animal.push_back(dna);
+            for (size_t k = 0; k < rows.size(); k++) {
+                const array<int, 4>& result = results[k];
+                if (result[1] != result[0] || result[2] != result[0] || result[3] != result[0]) {
+                    if (mismatches < 10) {
+                        cout << first.getName() << " vs " << second.getName() << " strand " << rows[k] << ": expected " << result[0]
+                             << ", got " << result[1] << " (band " << result[2] << ", narrower band " << result[3] << ")" << endl;
+                    }
+                    mismatches++;
+                }
+            }
+            checked += rows.size();
+        }
     }
+    cout << "edit distance checked on " << checked << " strand pairs, " << mismatches << " mismatches" << endl;
+    return mismatches == 0;
+}
 
-    return animal;
+// count every dataset and write the statistics table
+bool writeStatistics(const vector<unique_ptr<Dataset>>& datasets, const string& path) {
+    vector<const Dataset*> loaded;
+    for (size_t i = 0; i < datasets.size(); i++) {
+        datasets.at(i)->waitUntilLoaded();
+        loaded.push_back(datasets.at(i).get());
+    }
+
+    Statistics statistics;
+    statistics.compute(loaded);
+    if (path == "-") {
+        statistics.writeTable(cout);
+    } else {
+        ofstream fout(path);
+        if (fout.fail()) {
+            cerr << "Could not open " << path << " for writing" << endl;
+            return false;
+        }
+        statistics.writeTable(fout);
+        for (size_t i = 0; i < statistics.getSpeciesCount(); i++) {
+            const Statistics::Counts& counts = statistics.getSpecies(i);
+            cout << statistics.getSpeciesName(i) << ": " << counts.strandCount << " strands, " << counts.getLength() << " bases, "
+                 << counts.getGCContent() << "% GC, " << counts.getCodonTotal() << " codons" << endl;
+        }
+    }
+    return true;
 }
 
-int main() {
+// mutate every strand of every dataset and report how the changes move compareProteins
+void printMutationReport(const vector<unique_ptr<Dataset>>& datasets, const StrandSelection& selection, size_t replicates, const MutationModel& model, uint64_t seed) {
+    MutationSimulator simulator(model, seed);
+    for (size_t i = 0; i < datasets.size(); i++) {
+        const Dataset& dataset = *datasets.at(i);
+        dataset.waitUntilLoaded();
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        MutationSimulator::Summary summary = simulator.simulate(dataset, dataset.getTable().select(selection.predicates), replicates);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        uint64_t substitutions = summary.transitions + summary.transversions;
+        cout << dataset.getName() << ": " << summary.strands << " mutated strands, " << summary.getMutationCount() << " mutations in " << seconds << "s ("
+             << (seconds > 0 ? (double)summary.getMutationCount() / seconds : 0) << " per second)" << endl;
+        cout << "  substitutions " << substitutions << " (transitions " << summary.transitions << ", transversions " << summary.transversions
+             << "), insertions " << summary.insertions << ", deletions " << summary.deletions << endl;
+        cout << "  synonymous " << summary.synonymous << ", non-synonymous " << summary.nonSynonymous << " (nonsense " << summary.nonsense << ")" << endl;
+        cout << "  protein similarity to the original: " << summary.getMeanProteinSimilarity() << "% overall, "
+             << summary.getMeanSubstitutionOnlySimilarity() << "% for the " << summary.substitutionOnlyStrands << " strands without indels" << endl;
+    }
+}
+
+// write the analysis of every species and every pair of species to Arrow files, a block of strands at a time
+bool exportResults(const vector<unique_ptr<Dataset>>& datasets, const StrandSelection& selection, const string& prefix) {
+    vector<string> names;
+    for (size_t i = 0; i < datasets.size(); i++) {
+        names.push_back(datasets.at(i)->getName());
+    }
+    ResultExporter exporter(names);
+    if (!exporter.open(prefix)) {
+        cerr << "Could not create the export files " << prefix << ".*.arrow" << endl;
+        return false;
+    }
+
+    // each species is written as soon as it has loaded, while the others may still be loading
+    bool written = true;
+    for (size_t i = 0; i < datasets.size() && written; i++) {
+        const Dataset& dataset = *datasets.at(i);
+        dataset.waitUntilLoaded();
+        vector<uint32_t> rows = dataset.getTable().select(selection.predicates);
+        if (selection.sorted) {
+            dataset.getTable().sortRows(rows, selection.sortColumn, selection.descending);
+        }
+        written = exporter.exportSpecies(i, dataset, rows);
+    }
+    for (size_t i = 0; i < datasets.size() && written; i++) {
+        for (size_t j = i + 1; j < datasets.size() && written; j++) {
+            written = exporter.exportPair(i, j, *datasets.at(i), *datasets.at(j), selectSharedStrands(*datasets.at(i), *datasets.at(j), selection));
+        }
+    }
+    if (!exporter.close() || !written) {
+        cerr << "Could not write the export files " << prefix << ".*.arrow" << endl;
+        return false;
+    }
+    cout << exporter.getStrandCount() << " strands, " << exporter.getFrameCount() << " open reading frames and " << exporter.getPairCount()
+         << " strand pairs written to " << prefix << ".*.arrow" << endl;
+    return true;
+}
+
+// the server answering queries, stopped by SIGINT or SIGTERM
+ComparisonServer* runningServer = nullptr;
+
+void stopServer(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+// keep every dataset and its statistics in memory and answer queries on a socket until interrupted
+bool serveQueries(const vector<unique_ptr<Dataset>>& datasets, const string& path) {
+    vector<const Dataset*> loaded;
+    for (size_t i = 0; i < datasets.size(); i++) {
+        datasets.at(i)->waitUntilLoaded();
+        loaded.push_back(datasets.at(i).get());
+    }
+    Statistics statistics;
+    statistics.compute(loaded);
+
+    ComparisonServer server(loaded, statistics);
+    if (!server.listen(path)) {
+        cerr << "Could not listen on " << path << endl;
+        return false;
+    }
+    runningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    for (size_t i = 0; i < loaded.size(); i++) {
+        cout << i << ": " << loaded.at(i)->getName() << " (" << loaded.at(i)->getAvailableCount() << " strands)" << endl;
+    }
+    cout << "serving on " << path << endl;
+    server.run();
+    runningServer = nullptr;
+    cout << server.describeMetrics();
+    return true;
+}
+
+// one line per species for the statistics panel: composition, then the most used codons
+vector<string> describeStatistics(const Statistics& statistics, size_t species) {
+    const Statistics::Counts& counts = statistics.getSpecies(species);
+    vector<string> lines;
+    lines.push_back(statistics.getSpeciesName(species) + ": " + to_string(counts.strandCount) + " strands, " + to_string(counts.getLength()) + " bases");
+    ostringstream composition;
+    composition << fixed << setprecision(1) << "GC " << counts.getGCContent() << "%  A " << counts.bases[Statistics::A] << "  C " << counts.bases[Statistics::C]
+                << "  G " << counts.bases[Statistics::G] << "  T " << counts.bases[Statistics::T];
+    lines.push_back(composition.str());
+
+    vector<int> codons(Statistics::CODON_COUNT);
+    for (int i = 0; i < Statistics::CODON_COUNT; i++) {
+        codons.at(i) = i;
+    }
+    sort(codons.begin(), codons.end(), [&counts](int a, int b) { return counts.codons[a] > counts.codons[b]; });
+    ostringstream topCodons;
+    topCodons << fixed << setprecision(1) << "top codons:";
+    for (size_t i = 0; i < 4; i++) {
+        double share = counts.getCodonTotal() == 0 ? 0 : (double)counts.codons[codons.at(i)] / (double)counts.getCodonTotal() * 100;
+        topCodons << " " << Protein::getCodonName(codons.at(i)) << " (" << Protein::getProteinName(codons.at(i)) << ") " << share << "%";
+    }
+    lines.push_back(topCodons.str());
+
+    map<string, uint64_t> aminoAcids = counts.getAminoAcidCounts();
+    vector<pair<uint64_t, string>> ranked;
+    for (const auto& aminoAcid : aminoAcids) {
+        ranked.push_back(make_pair(aminoAcid.second, aminoAcid.first));
+    }
+    sort(ranked.rbegin(), ranked.rend());
+    string topAminoAcids = "top amino acids:";
+    for (size_t i = 0; i < 5 && i < ranked.size(); i++) {
+        topAminoAcids += " " + ranked.at(i).second;
+    }
+    lines.push_back(topAminoAcids);
+    return lines;
+}
+
+// build a text of the viewer; the font has to outlive it
+sf::Text makeText(const sf::Font& font, const string& value, unsigned size, sf::Vector2f position, sf::Color color) {
+    sf::Text text( font );
+    text.setString(value);
+    text.setCharacterSize(size);
+    text.setPosition(position);
+    text.setFillColor(color);
+    return text;
+}
+
+int main(int argc, char* argv[]) {
     int strandIndex = 0;
+    // position of the strand among the browsable ones; the same as strandIndex without a filter
+    int strandPosition = 0;
 
     // set up values for the key
     string nucleotides[4] = {"Adenosine", "Thymine", "Cytosine", "Guanine"};
@@ -55,182 +386,582 @@ int main() {
     string proteins[21] = {"Phenylalanine","Leucine","Serine","Tyrosine","Stop","Cysteine","Tryptophan","Proline","Histidine","Glutamine","Arginine","Isoleucine","Methionine","Threonine","Asparagine","Lysine","Valine","Alanine","Aspartate","Glutamate","Glycine"};
     vector<sf::Color> proteinColors = {sf::Color::Green, sf::Color::Blue, sf::Color::Yellow, sf::Color::Magenta, sf::Color::Red, sf::Color(35, 84, 17), sf::Color(141, 186, 224), sf::Color::Cyan, sf::Color(210, 250, 211), sf::Color(247, 233, 151), sf::Color(207, 133, 6), sf::Color(168, 63, 176), sf::Color(122, 40, 57), sf::Color(119, 71, 161), sf::Color(69, 135, 111), sf::Color(41, 0, 92), sf::Color(140, 106, 11), sf::Color(77, 16, 29), sf::Color(94, 138, 135), sf::Color::White, sf::Color(205, 255, 97)};
     
-    string animal1;
-    string animal2;
+    bool matrixMode = false;
+    string statisticsPath;
+    size_t mutationReplicates = 0;
+    MutationModel mutationModel;
+    uint64_t mutationSeed = 1;
+    string cachePath = "datasets/results.cache";
+    string servePath;
+    string exportPrefix;
+    bool memoryReport = false;
+    bool editDistanceCheck = false;
+    StrandSelection selection;
+    unsigned frameLimit = 60;
+    bool verticalSync = false;
+    vector<string> animals;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--matrix") {
+            matrixMode = true;
+        } else if (arg == "--stats" && i + 1 < argc) {
+            statisticsPath = argv[++i];
+        } else if (arg == "--mutate" && i + 1 < argc) {
+            mutationReplicates = (size_t)stoul(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            // insertions and deletions together are a tenth as common as substitutions
+            mutationModel.substitutionRate = stod(argv[++i]);
+            mutationModel.insertionRate = mutationModel.substitutionRate / 20;
+            mutationModel.deletionRate = mutationModel.substitutionRate / 20;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            mutationSeed = stoull(argv[++i]);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (arg == "--no-cache") {
+            cachePath.clear();
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (arg == "--export" && i + 1 < argc) {
+            exportPrefix = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            if (!StrandTable::parsePredicates(argv[++i], selection.predicates)) {
+                cerr << "Could not parse the filter " << argv[i] << endl;
+                return -1;
+            }
+        } else if (arg == "--sort" && i + 1 < argc) {
+            string column = argv[++i];
+            selection.descending = !column.empty() && column[0] == '-';
+            if (!StrandTable::parseColumn(selection.descending ? column.substr(1) : column, selection.sortColumn)) {
+                cerr << "Unknown column " << column << endl;
+                return -1;
+            }
+            selection.sorted = true;
+        } else if (arg == "--memory") {
+            memoryReport = true;
+        } else if (arg == "--check-edit-distance") {
+            editDistanceCheck = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            frameLimit = (unsigned)stoul(argv[++i]);
+        } else if (arg == "--vsync") {
+            verticalSync = true;
+        } else if (find(animals.begin(), animals.end(), arg) == animals.end()) {
+            animals.push_back(arg);
+        }
+    }
 
     // have user select animals
-    do {
-        cout << "Enter first animal: (chimpanzee, human, or dog) ";
-        cin >> animal1;
-    } while (animal1 != "chimpanzee" && animal1 != "human" && animal1 != "dog");
-    do {
-        cout << "Enter second animal: (chimpanzee, human, or dog) ";
-        cin >> animal2;
-    } while ((animal2 != "chimpanzee" && animal2 != "human" && animal2 != "dog") || animal2 == animal1);
+    while (animals.size() < 2) {
+        cout << "Enter two or more animals separated by spaces: (e.g. chimpanzee human dog) ";
+        string line;
+        if (!getline(cin, line)) {
+            return -1;
+        }
+        animals.clear();
+        istringstream names(line);
+        string name;
+        while (names >> name) {
+            if (!datasetExists(name)) {
+                cout << "No dataset found at datasets/" << name << ".txt" << endl;
+            } else if (find(animals.begin(), animals.end(), name) == animals.end()) {
+                animals.push_back(name);
+            }
+        }
+    }
+
+    // static so background comparisons still running at exit never outlive it
+    static ResultCache resultCache;
+    if (!cachePath.empty()) {
+        if (resultCache.open(cachePath)) {
+            StrandStore::shared().setResultCache(&resultCache);
+        } else {
+            cerr << "Could not open the result cache " << cachePath << ", results will not be kept" << endl;
+        }
+    }
 
-    vector<DNAStrand> chimpanzee = readFile(animal1);
-    vector<DNAStrand> dog = readFile(animal2);
+    // load every dataset in the background while the window opens
+    vector<unique_ptr<Dataset>> datasets;
+    for (size_t i = 0; i < animals.size(); i++) {
+        datasets.push_back(make_unique<Dataset>(animals.at(i)));
+        datasets.back()->loadAsync(TaskScheduler::Priority::Batch);
+    }
 
-    // Find size of display (min size)
-    size_t end = chimpanzee.size();
-    if (dog.size() < end) {
-        end = dog.size();
+    if (matrixMode || editDistanceCheck || !statisticsPath.empty() || mutationReplicates > 0 || !exportPrefix.empty() || !servePath.empty()) {
+        int result = 0;
+        if (editDistanceCheck) {
+            result = checkEditDistance(datasets, selection) ? 0 : -1;
+        } else if (matrixMode) {
+            printSimilarityMatrix(datasets, selection);
+            if (resultCache.isOpen()) {
+                cout << resultCache.getHitCount() << " cached results reused, " << resultCache.getMissCount() << " computed, "
+                     << resultCache.getEntryCount() << " kept in " << cachePath << endl;
+            }
+        } else if (!statisticsPath.empty()) {
+            result = writeStatistics(datasets, statisticsPath) ? 0 : -1;
+        } else if (mutationReplicates > 0) {
+            printMutationReport(datasets, selection, mutationReplicates, mutationModel, mutationSeed);
+        } else if (!exportPrefix.empty()) {
+            result = exportResults(datasets, selection, exportPrefix) ? 0 : -1;
+        } else {
+            result = serveQueries(datasets, servePath) ? 0 : -1;
+        }
+        if (memoryReport) {
+            // on stderr so it never mixes into a table written to stdout
+            cerr << "memory:" << endl;
+            vector<string> lines = MemoryAccounting::describeUsage();
+            for (size_t i = 0; i < lines.size(); i++) {
+                cerr << "  " << lines.at(i) << endl;
+            }
+            for (size_t i = 0; i < datasets.size(); i++) {
+                if (datasets.at(i)->hasFailed()) {
+                    continue;
+                }
+                const StrandArena& arena = datasets.at(i)->getArena();
+                cerr << "  " << arena.getName() << " strands: " << arena.getUsedBytes() / 1024 << " KB in " << arena.getBlockCount() << " blocks" << endl;
+            }
+        }
+        return result;
     }
 
+    // from here on allocations belong to the viewer unless a subsystem claims them
+    MemoryScope renderScope(MemoryTag::Render);
+
+    // the pair of species being compared
+    size_t firstSpecies = 0;
+    size_t secondSpecies = 1;
+
     // Create Window
-    sf::Vector2u windowSize(996, 500);
+    sf::Vector2u windowSize(996, 560);
     sf::RenderWindow window( sf::VideoMode( windowSize ), "DNA Analyzer" );
+    // SFML must not combine the two, so vsync takes the place of the frame limit
+    if (verticalSync) {
+        window.setVerticalSyncEnabled(true);
+    } else {
+        window.setFramerateLimit(frameLimit);
+    }
+    // held arrow keys scroll on a timer rather than the system key repeat, so the speed is the same everywhere
+    window.setKeyRepeatEnabled(false);
 
     int scrollPos = 0;
+    int scrollDirection = 0;
+    int heldSteps = 0;
+    sf::Clock scrollClock;
+    const float scrollDelay = 0.35f;
+    const float scrollRate = 30.f;
+
+    // comparison data is only rebuilt when the strand changes, and reused when one of the last few pairs of
+    // interned strands comes back (most recently used first)
+    int indexedStrand = -1;
+    vector<CachedComparison> comparisonCache;
+    pair<shared_ptr<const DNAStrand>, shared_ptr<const DNAStrand>> comparedStrands;
+    StrandComparison comparison;
+    bool hasComparison = false;
+    future<StrandComparison> pendingComparison;
+    CancelToken comparisonToken;
+    const MatchIndex& matchIndex = comparison.matchIndex;
+
+    // overview tracks of the current strand and of the whole dataset, built in the background
+    OverviewTrack strandOverview;
+    OverviewTrack datasetOverview;
+    pair<size_t, size_t> datasetOverviewSpecies(0, 0);
+    bool overviewsBuilding = false;
+
+    // strands the selection lets through, found once both datasets are loaded
+    vector<uint32_t> selectedRows;
+    pair<size_t, size_t> selectedSpecies(0, 0);
+    bool hasSelectedRows = false;
+
+    // statistics of every dataset, counted in the background once all of them are loaded
+    bool showStatistics = false;
+    shared_ptr<const Statistics> statistics;
+    future<shared_ptr<const Statistics>> pendingStatistics;
+
+    // memory use per subsystem, shown in place of the statistics and refreshed while open
+    bool showMemory = false;
+    sf::Clock memoryClock;
+    const float memoryRefresh = 0.5f;
+
+    // the scene is kept between frames: the font, headers and key are built once and the rest of the text only gets new strings
+    sf::Font myFont;
+    if( !myFont.openFromFile( "datasets/arial.ttf" ) )
+        return -1;
+    vector<sf::Text> staticTexts;
+    vector<sf::RectangleShape> keySwatches;
+    staticTexts.push_back(makeText(myFont, "nucleotide clusters: ", 25, sf::Vector2f(10.f, 40.f), sf::Color::White));
+    staticTexts.push_back(makeText(myFont, "protein clusters: ", 25, sf::Vector2f(10.f, 145.f), sf::Color::White));
+    staticTexts.push_back(makeText(myFont, "key:", 25, sf::Vector2f(10.f, 255.f), sf::Color::White));
+    staticTexts.push_back(makeText(myFont, "strand overview / dataset overview (+/- or wheel to zoom, click to jump):", 13, sf::Vector2f(10.f, 480.f), sf::Color::White));
+
+    // key for nucleotides, then for proteins in columns of nine
+    for (size_t i = 0; i < 4 + 21; i++) {
+        bool isNucleotide = i < 4;
+        size_t column = isNucleotide ? 0 : 1 + (i - 4) / 9;
+        size_t row = isNucleotide ? i : (i - 4) % 9;
+        sf::Vector2f position(column == 0 ? 10.f : (float)column * 150.f, 300.f + (float)row * 20.f);
+        sf::RectangleShape rect;
+        rect.setSize(sf::Vector2f(15, 15));
+        rect.setFillColor(isNucleotide ? nucleotideColors.at(i) : proteinColors.at(i - 4));
+        rect.setPosition(position);
+        keySwatches.push_back(rect);
+        staticTexts.push_back(makeText(myFont, isNucleotide ? nucleotides[i] : proteins[i - 4], 15, sf::Vector2f(position.x + 20.f, position.y), sf::Color::White));
+    }
+
+    sf::Text title = makeText(myFont, "", 30, sf::Vector2f(10.f, 0.f), sf::Color::White);
+    sf::Text progress = makeText(myFont, "", 15, sf::Vector2f(400.f, 45.f), sf::Color::Yellow);
+    sf::Text similarity1 = makeText(myFont, "", 15, sf::Vector2f(10.f, 65.f), sf::Color::White);
+    sf::Text similarity2 = makeText(myFont, "", 15, sf::Vector2f(10.f, 170.f), sf::Color::White);
+    vector<sf::Text> statisticsLines;
+
+    // only redraw once something on screen may have changed
+    bool needsRedraw = true;
+    string shownStatus;
 
     while( window.isOpen() ) {
-        window.clear(sf::Color(0, 0, 0));
+        Dataset& firstDataset = *datasets.at(firstSpecies);
+        Dataset& secondDataset = *datasets.at(secondSpecies);
+
+        // Find size of display (min size), only strands loaded in both datasets can be browsed
+        size_t end = firstDataset.getAvailableCount();
+        if (secondDataset.getAvailableCount() < end) {
+            end = secondDataset.getAvailableCount();
+        }
+        bool loading = !firstDataset.isLoaded() || !secondDataset.isLoaded();
+        if (selection.isActive()) {
+            // the tables only exist once loading is done
+            if (!loading && (!hasSelectedRows || selectedSpecies != make_pair(firstSpecies, secondSpecies))) {
+                selectedRows = selectSharedStrands(firstDataset, secondDataset, selection);
+                selectedSpecies = make_pair(firstSpecies, secondSpecies);
+                hasSelectedRows = true;
+                strandPosition = 0;
+                needsRedraw = true;
+            }
+            end = loading ? 0 : selectedRows.size();
+        }
+        if (end > 0 && strandPosition >= (int)end) {
+            strandPosition = (int)end - 1;
+        }
+        strandIndex = selection.isActive() && end > 0 ? (int)selectedRows.at((size_t)strandPosition) : strandPosition;
+        if (!loading && datasetOverviewSpecies != make_pair(firstSpecies, secondSpecies)) {
+            datasetOverview.buildAsync([&firstDataset, &secondDataset]() {
+                return OverviewTrack::sampleDataset(firstDataset, secondDataset);
+            }, TaskScheduler::Priority::Batch);
+            datasetOverviewSpecies = make_pair(firstSpecies, secondSpecies);
+        }
+        bool allLoaded = true;
+        for (size_t i = 0; i < datasets.size(); i++) {
+            allLoaded = allLoaded && (datasets.at(i)->isLoaded() || datasets.at(i)->hasFailed());
+        }
+        if (allLoaded && statistics == nullptr && !pendingStatistics.valid()) {
+            pendingStatistics = TaskScheduler::shared().async([&datasets]() {
+                vector<const Dataset*> loaded;
+                for (size_t i = 0; i < datasets.size(); i++) {
+                    loaded.push_back(datasets.at(i).get());
+                }
+                shared_ptr<Statistics> result = make_shared<Statistics>();
+                result->compute(loaded);
+                return shared_ptr<const Statistics>(result);
+            }, TaskScheduler::Priority::Batch);
+        }
+        if (pendingStatistics.valid() && pendingStatistics.wait_for(chrono::seconds(0)) == future_status::ready) {
+            statistics = pendingStatistics.get();
+            needsRedraw = true;
+        }
 
         // pull data about comparisons from class algorithms
-        vector<int> similarityClusters = chimpanzee.at(strandIndex).findClusters(dog.at(strandIndex));
-        vector<int> similarityClustersP = chimpanzee.at(strandIndex).findProteinClusters(dog.at(strandIndex));
-        double similiarityPercentage = chimpanzee.at(strandIndex).compareDNA(dog.at(strandIndex));
-        double similiarityPercentageP = chimpanzee.at(strandIndex).compareProteins(dog.at(strandIndex));
-
-        // display nucleotides
-        chimpanzee.at(strandIndex).drawNucleotides(window, sf::Vector2f(0, 90), scrollPos);
-        dog.at(strandIndex).drawNucleotides(window, sf::Vector2f(0, 115), scrollPos);
-        chimpanzee.at(strandIndex).highlightNucleotideClusters(window, sf::Vector2f(10, 140), scrollPos, similarityClusters);
-
-        // display proteins
-        chimpanzee.at(strandIndex).drawProteins(window, sf::Vector2f(0, 195), scrollPos);
-        dog.at(strandIndex).drawProteins(window, sf::Vector2f(0, 220), scrollPos);
-        chimpanzee.at(strandIndex).highlightProteinClusters(window, sf::Vector2f(0, 245), scrollPos, similarityClustersP);
-
-        // display text
-        sf::Font myFont;
-        if( !myFont.openFromFile( "datasets/arial.ttf" ) )
-            return -1;
-        sf::Text title( myFont );
-        title.setString( "dna strand comparison: " + animal1 + " vs " + animal2 + " (strand #" + to_string(strandIndex) + ")");
-        title.setPosition( sf::Vector2f(10.f, 0.f) );
-        title.setFillColor( sf::Color::White );
-        window.draw( title ); 
-
-        // nucleotide header text
-        sf::Text subtitle1( myFont );
-        subtitle1.setString( "nucleotide clusters: ");
-        subtitle1.setCharacterSize(25);
-        subtitle1.setPosition( sf::Vector2f(10.f, 40.f) );
-        subtitle1.setFillColor( sf::Color::White );
-        window.draw( subtitle1 ); 
-        sf::Text similarity1( myFont );
-        similarity1.setString( "overall similarity: " + to_string(similiarityPercentage) + "%");
-        similarity1.setCharacterSize(15);
-        similarity1.setPosition( sf::Vector2f(10.f, 65.f) );
-        similarity1.setFillColor( sf::Color::White );
-        window.draw( similarity1 ); 
-
-        // protein header text
-        sf::Text subtitle2( myFont );
-        subtitle2.setString( "protein clusters: ");
-        subtitle2.setCharacterSize(25);
-        subtitle2.setPosition( sf::Vector2f(10.f, 145.f) );
-        subtitle2.setFillColor( sf::Color::White );
-        window.draw( subtitle2 ); 
-        sf::Text similarity2( myFont );
-        similarity2.setString( "overall similarity: " + to_string(similiarityPercentageP) + "%");
-        similarity2.setCharacterSize(15);
-        similarity2.setPosition( sf::Vector2f(10.f, 170.f) );
-        similarity2.setFillColor( sf::Color::White );
-        window.draw( similarity2 ); 
-
-        // key title
-        sf::Text keytitle( myFont );
-        keytitle.setString( "key:");
-        keytitle.setCharacterSize(25);
-        keytitle.setPosition( sf::Vector2f(10.f, 255.f) );
-        keytitle.setFillColor( sf::Color::White );
-        window.draw( keytitle ); 
-
-        // create the key for nucleotides
-        for (size_t i = 0; i < 4; i++) {
-            sf::RectangleShape rect;
-            rect.setSize(sf::Vector2f(15, 15));
-            rect.setFillColor(nucleotideColors.at(i));
-            rect.setPosition(sf::Vector2f(10, 300 + (float)i * 20.f));
-            window.draw( rect ); 
-
-            sf::Text keyItem( myFont );
-            keyItem.setString(nucleotides[i]);
-            keyItem.setCharacterSize(15);
-            keyItem.setPosition( sf::Vector2f(30.f, 300 + (float)i * 20.f) );
-            keyItem.setFillColor( sf::Color::White );
-            window.draw( keyItem ); 
-        }
-
-        // create the key for proteins by column
-        for (size_t i = 0; i < 9; i++) {
-            sf::RectangleShape rect;
-            rect.setSize(sf::Vector2f(15, 15));
-            rect.setFillColor(proteinColors.at(i));
-            rect.setPosition(sf::Vector2f(150, 300 + (float)i * 20.f));
-            window.draw( rect ); 
-
-            sf::Text keyItem( myFont );
-            keyItem.setString(proteins[i]);
-            keyItem.setCharacterSize(15);
-            keyItem.setPosition( sf::Vector2f(170.f, 300 + (float)i * 20.f) );
-            keyItem.setFillColor( sf::Color::White );
-            window.draw( keyItem ); 
-        }
-        for (size_t i = 9; i < 18; i++) {
-            sf::RectangleShape rect;
-            rect.setSize(sf::Vector2f(15, 15));
-            rect.setFillColor(proteinColors.at(i));
-            rect.setPosition(sf::Vector2f(300, 300 + (float)(i-9) * 20.f));
-            window.draw( rect ); 
-
-            sf::Text keyItem( myFont );
-            keyItem.setString(proteins[i]);
-            keyItem.setCharacterSize(15);
-            keyItem.setPosition( sf::Vector2f(320.f, 300 + (float)(i-9) * 20.f) );
-            keyItem.setFillColor( sf::Color::White );
-            window.draw( keyItem ); 
-        }
-        for (size_t i = 18; i < 21; i++) {
-            sf::RectangleShape rect;
-            rect.setSize(sf::Vector2f(15, 15));
-            rect.setFillColor(proteinColors.at(i));
-            rect.setPosition(sf::Vector2f(450, 300 + (float)(i-18) * 20.f));
-            window.draw( rect ); 
-
-            sf::Text keyItem( myFont );
-            keyItem.setString(proteins[i]);
-            keyItem.setCharacterSize(15);
-            keyItem.setPosition( sf::Vector2f(470.f, 300 + (float)(i-18) * 20.f) );
-            keyItem.setFillColor( sf::Color::White );
-            window.draw( keyItem ); 
-        }
-
-        window.display();
-
-        // close event
-        while( const std::optional event = window.pollEvent() ) {
+        if (end > 0 && indexedStrand != strandIndex) {
+            // drop the work for the strand the user navigated away from
+            comparisonToken.cancel();
+            comparisonToken = CancelToken();
+            hasComparison = false;
+            pendingComparison = future<StrandComparison>();
+            shared_ptr<const DNAStrand> firstStrand = firstDataset.getStrand(strandIndex);
+            shared_ptr<const DNAStrand> secondStrand = secondDataset.getStrand(strandIndex);
+            comparedStrands = make_pair(firstStrand, secondStrand);
+            auto cached = find_if(comparisonCache.begin(), comparisonCache.end(), [&](const CachedComparison& entry) {
+                return entry.first == firstStrand && entry.second == secondStrand;
+            });
+            if (cached != comparisonCache.end()) {
+                rotate(comparisonCache.begin(), cached, cached + 1);
+                comparison = comparisonCache.front().comparison;
+                hasComparison = true;
+            } else {
+                pendingComparison = TaskScheduler::shared().async([firstStrand, secondStrand]() {
+                    StrandComparison result;
+                    result.matchIndex.build(*firstStrand, *secondStrand);
+                    // the clusters come from the index rather than another pass over the bases
+                    result.similarityClusters = result.matchIndex.findClusters();
+                    result.similarityClustersP = result.matchIndex.findProteinClusters();
+                    result.editDistance = StrandStore::shared().editDistance(firstStrand, secondStrand);
+                    return result;
+                }, TaskScheduler::Priority::Interactive, comparisonToken);
+            }
+            indexedStrand = strandIndex;
+            needsRedraw = true;
+
+            const DNAStrand* first = &firstDataset.at(strandIndex);
+            const DNAStrand* second = &secondDataset.at(strandIndex);
+            strandOverview.buildAsync([first, second]() {
+                return OverviewTrack::sampleStrands(*first, *second);
+            }, TaskScheduler::Priority::Interactive);
+        }
+        if (pendingComparison.valid() && pendingComparison.wait_for(chrono::seconds(0)) == future_status::ready) {
+            try {
+                comparison = pendingComparison.get();
+                MemoryScope cacheScope(MemoryTag::Caches);
+                comparisonCache.insert(comparisonCache.begin(), CachedComparison{comparedStrands.first, comparedStrands.second, comparison});
+                if (comparisonCache.size() > COMPARISON_CACHE_SIZE) {
+                    comparisonCache.pop_back();
+                }
+                hasComparison = true;
+            } catch (const future_error&) {
+                // cancelled before it ran
+            }
+            needsRedraw = true;
+        }
+
+        // a finished overview only shows up once drawn again
+        bool building = strandOverview.isBuilding() || datasetOverview.isBuilding();
+        if (overviewsBuilding && !building) {
+            needsRedraw = true;
+        }
+        overviewsBuilding = building;
+
+        // loading progress
+        string status;
+        for (size_t i = 0; i < datasets.size(); i++) {
+            if (datasets.at(i)->hasFailed()) {
+                status += "could not open " + datasets.at(i)->getName() + ".txt   ";
+            } else if (!datasets.at(i)->isLoaded()) {
+                status += datasets.at(i)->getName() + ": " + to_string((int)(datasets.at(i)->getProgress() * 100)) + "% (" + to_string(datasets.at(i)->getAvailableCount()) + " strands)   ";
+            }
+        }
+        if (selection.isActive() && !loading && selectedRows.empty()) {
+            status += "no strands match the filter";
+        }
+        if (status != shownStatus) {
+            shownStatus = status;
+            needsRedraw = true;
+        }
+
+        // a held arrow key moves one base at once, then keeps going at a steady rate after a short delay
+        if (scrollDirection != 0) {
+            float held = scrollClock.getElapsedTime().asSeconds() - scrollDelay;
+            int steps = held > 0 ? (int)(held * scrollRate) : 0;
+            if (steps > heldSteps) {
+                scrollPos += scrollDirection * (steps - heldSteps);
+                heldSteps = steps;
+                needsRedraw = true;
+            }
+        }
+        // keep the view on bases both strands have
+        if (end > 0) {
+            size_t length = min(firstDataset.at(strandIndex).getSequence().length(), secondDataset.at(strandIndex).getSequence().length());
+            int lastPos = length > 0 ? (int)length - 1 : 0;
+            scrollPos = min(scrollPos, lastPos);
+        }
+        scrollPos = max(scrollPos, 0);
+
+        if (showMemory && memoryClock.getElapsedTime().asSeconds() >= memoryRefresh) {
+            memoryClock.restart();
+            needsRedraw = true;
+        }
+
+        if (needsRedraw) {
+            window.clear(sf::Color(0, 0, 0));
+
+            double similiarityPercentage = matchIndex.compareDNA(0, matchIndex.getNucleotideLength());
+            double similiarityPercentageP = matchIndex.compareProteins(0, matchIndex.getProteinLength());
+
+            // similarity of the region currently on screen
+            size_t visibleStart = (size_t)scrollPos;
+            double visiblePercentage = matchIndex.compareDNA(visibleStart, visibleStart + window.getSize().x / 12);
+            double visiblePercentageP = matchIndex.compareProteins(visibleStart / 3, visibleStart / 3 + window.getSize().x / 36 + 1);
+
+            if (end > 0) {
+                // display nucleotides
+                firstDataset.at(strandIndex).drawNucleotides(window, sf::Vector2f(0, 90), scrollPos);
+                secondDataset.at(strandIndex).drawNucleotides(window, sf::Vector2f(0, 115), scrollPos);
+                if (hasComparison) {
+                    firstDataset.at(strandIndex).highlightNucleotideClusters(window, sf::Vector2f(10, 140), scrollPos, comparison.similarityClusters);
+                }
+
+                // display proteins
+                firstDataset.at(strandIndex).drawProteins(window, sf::Vector2f(0, 195), scrollPos);
+                secondDataset.at(strandIndex).drawProteins(window, sf::Vector2f(0, 220), scrollPos);
+                if (hasComparison) {
+                    firstDataset.at(strandIndex).highlightProteinClusters(window, sf::Vector2f(0, 245), scrollPos, comparison.similarityClustersP);
+                }
+            }
+
+            // display text
+            string shownStrand = "strand #" + to_string(strandIndex);
+            if (selection.isActive() && end > 0) {
+                shownStrand += ", " + to_string(strandPosition + 1) + " of " + to_string(end) + " selected";
+            }
+            title.setString( "dna strand comparison: " + firstDataset.getName() + " vs " + secondDataset.getName() + " (" + shownStrand + ")");
+            window.draw( title );
+            if (!status.empty()) {
+                progress.setString( "loading... " + status );
+                window.draw( progress );
+            }
+            similarity1.setString( hasComparison ? "overall similarity: " + to_string(similiarityPercentage) + "%    visible similarity: " + to_string(visiblePercentage) + "%    edit distance: " + to_string(comparison.editDistance) : "computing...");
+            window.draw( similarity1 );
+            similarity2.setString( hasComparison ? "overall similarity: " + to_string(similiarityPercentageP) + "%    visible similarity: " + to_string(visiblePercentageP) + "%" : "computing...");
+            window.draw( similarity2 );
+
+            // headers and key
+            for (size_t i = 0; i < staticTexts.size(); i++) {
+                window.draw( staticTexts.at(i) );
+            }
+            for (size_t i = 0; i < keySwatches.size(); i++) {
+                window.draw( keySwatches.at(i) );
+            }
+
+            // statistics or memory panel
+            if (showStatistics || showMemory) {
+                vector<string> lines;
+                if (showMemory) {
+                    lines = MemoryAccounting::describeUsage();
+                } else if (statistics == nullptr) {
+                    lines.push_back("counting statistics...");
+                } else {
+                    size_t shown[2] = {firstSpecies, secondSpecies};
+                    for (size_t i = 0; i < 2; i++) {
+                        vector<string> speciesLines = describeStatistics(*statistics, shown[i]);
+                        lines.insert(lines.end(), speciesLines.begin(), speciesLines.end());
+                    }
+                    if (end > 0 && (size_t)strandIndex < statistics->getStrandCount(firstSpecies)) {
+                        // any range of the profile is answered in constant time
+                        const BaseProfile& profile = statistics->getProfile(firstSpecies, (size_t)strandIndex);
+                        ostringstream strandLine;
+                        strandLine << fixed << setprecision(1) << "strand GC " << profile.getGCContent(0, profile.getLength())
+                                   << "%, visible GC " << profile.getGCContent((size_t)scrollPos, (size_t)scrollPos + window.getSize().x / 12) << "%";
+                        lines.push_back(strandLine.str());
+                    }
+                }
+                while (statisticsLines.size() < lines.size()) {
+                    statisticsLines.push_back(makeText(myFont, "", 12, sf::Vector2f(540.f, 260.f + (float)statisticsLines.size() * 16.f), sf::Color::White));
+                }
+                for (size_t i = 0; i < lines.size(); i++) {
+                    statisticsLines.at(i).setString(lines.at(i));
+                    window.draw( statisticsLines.at(i) );
+                }
+            }
+
+            // overview tracks
+            strandOverview.draw(window, sf::Vector2f(10, 498), (size_t)scrollPos, window.getSize().x / 12);
+            datasetOverview.draw(window, sf::Vector2f(10, 528), (size_t)strandIndex, 1);
+
+            window.display();
+            needsRedraw = false;
+        }
+
+        // sleep until input arrives; background work is looked at on a short timeout, and a held arrow key once a frame
+        sf::Time timeout = sf::Time::Zero;
+        if (scrollDirection != 0) {
+            timeout = sf::milliseconds(frameLimit > 0 ? 1000 / (int)frameLimit : 1);
+        } else if (!allLoaded || pendingComparison.valid() || pendingStatistics.valid() || overviewsBuilding) {
+            timeout = sf::milliseconds(100);
+        } else if (showMemory) {
+            timeout = sf::seconds(memoryRefresh);
+        }
+
+        // handle everything queued before drawing again, so bursts of input cost one frame
+        for (std::optional<sf::Event> event = window.waitEvent(timeout); event; event = window.pollEvent()) {
+            if (!event->is<sf::Event::MouseMoved>()) {
+                needsRedraw = true;
+            }
             if( event->is<sf::Event::Closed>() ) {
                 window.close();
             }
+            if (event->is<sf::Event::FocusLost>()) {
+                scrollDirection = 0;
+            }
             if (event->is<sf::Event::KeyPressed>()){
                 const sf::Event::KeyPressed* keyEvent = event->getIf<sf::Event::KeyPressed>();
                 // manage up/down and left/right scrolling
-                if (keyEvent->code == sf::Keyboard::Key::Right) {
-                    scrollPos++;
-                } else if (keyEvent->code == sf::Keyboard::Key::Left && scrollPos > 0){
-                    scrollPos--;
-                } else if (keyEvent->code == sf::Keyboard::Key::Up && strandIndex > 0) {
-                    strandIndex--;
+                if (keyEvent->code == sf::Keyboard::Key::Right || keyEvent->code == sf::Keyboard::Key::Left) {
+                    scrollDirection = keyEvent->code == sf::Keyboard::Key::Right ? 1 : -1;
+                    scrollPos += scrollDirection;
+                    heldSteps = 0;
+                    scrollClock.restart();
+                } else if (keyEvent->code == sf::Keyboard::Key::Up && strandPosition > 0) {
+                    strandPosition--;
                     scrollPos = 0;
-                } else if (keyEvent->code == sf::Keyboard::Key::Down && strandIndex < (int)end - 1) {
-                    strandIndex++;
+                } else if (keyEvent->code == sf::Keyboard::Key::Down && strandPosition < (int)end - 1) {
+                    strandPosition++;
                     scrollPos = 0;
+                } else if (keyEvent->code == sf::Keyboard::Key::Tab) {
+                    // cycle one side of the comparison through the other species
+                    size_t& species = keyEvent->shift ? firstSpecies : secondSpecies;
+                    size_t other = keyEvent->shift ? secondSpecies : firstSpecies;
+                    do {
+                        species = (species + 1) % datasets.size();
+                    } while (species == other);
+                    indexedStrand = -1;
+                    scrollPos = 0;
+                } else if (keyEvent->code == sf::Keyboard::Key::Equal && strandOverview.isReady()) {
+                    strandOverview.zoomIn((size_t)scrollPos);
+                } else if (keyEvent->code == sf::Keyboard::Key::Hyphen && strandOverview.isReady()) {
+                    strandOverview.zoomOut((size_t)scrollPos);
+                } else if (keyEvent->code == sf::Keyboard::Key::S) {
+                    showStatistics = !showStatistics;
+                    showMemory = false;
+                } else if (keyEvent->code == sf::Keyboard::Key::M) {
+                    showMemory = !showMemory;
+                    showStatistics = false;
+                    memoryClock.restart();
+                }
+            }
+            if (event->is<sf::Event::KeyReleased>()) {
+                const sf::Event::KeyReleased* keyEvent = event->getIf<sf::Event::KeyReleased>();
+                if ((keyEvent->code == sf::Keyboard::Key::Right && scrollDirection > 0) || (keyEvent->code == sf::Keyboard::Key::Left && scrollDirection < 0)) {
+                    scrollDirection = 0;
+                }
+            }
+            if (event->is<sf::Event::MouseWheelScrolled>()) {
+                const sf::Event::MouseWheelScrolled* wheelEvent = event->getIf<sf::Event::MouseWheelScrolled>();
+                sf::Vector2f point((float)wheelEvent->position.x, (float)wheelEvent->position.y);
+                // zoom the track under the cursor around the sample under the cursor
+                OverviewTrack* track = nullptr;
+                if (strandOverview.isReady() && strandOverview.contains(point)) {
+                    track = &strandOverview;
+                } else if (datasetOverview.isReady() && datasetOverview.contains(point)) {
+                    track = &datasetOverview;
+                }
+                if (track != nullptr && wheelEvent->delta > 0) {
+                    track->zoomIn(track->findPosition(point.x));
+                } else if (track != nullptr && wheelEvent->delta < 0) {
+                    track->zoomOut(track->findPosition(point.x));
+                }
+            }
+            if (event->is<sf::Event::MouseButtonPressed>()) {
+                const sf::Event::MouseButtonPressed* mouseEvent = event->getIf<sf::Event::MouseButtonPressed>();
+                sf::Vector2f point((float)mouseEvent->position.x, (float)mouseEvent->position.y);
+                // jump to the clicked position, centering it in the main view
+                if (strandOverview.isReady() && strandOverview.contains(point)) {
+                    int target = (int)strandOverview.findPosition(point.x) - (int)(window.getSize().x / 24);
+                    scrollPos = target > 0 ? target : 0;
+                } else if (datasetOverview.isReady() && datasetOverview.contains(point)) {
+                    size_t target = datasetOverview.findPosition(point.x);
+                    if (selection.isActive()) {
+                        // only strands in the selection can be jumped to
+                        vector<uint32_t>::iterator found = find(selectedRows.begin(), selectedRows.end(), (uint32_t)target);
+                        if (found != selectedRows.end()) {
+                            strandPosition = (int)(found - selectedRows.begin());
+                            scrollPos = 0;
+                        }
+                    } else if (target < end) {
+                        strandPosition = (int)target;
+                        scrollPos = 0;
+                    }
                 }
             }
         }
     }
+
+    // the statistics task reads the datasets, so it has to finish before they are freed
+    if (pendingStatistics.valid()) {
+        pendingStatistics.wait();
+    }
     return 0;
 }
\ No newline at end of file
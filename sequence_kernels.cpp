@@ -0,0 +1,268 @@
+#include "sequence_kernels.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEQUENCE_KERNELS_SSSE3
+#include <tmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+    /**
+     * @brief 256 entry lookup tables used by the scalar paths and for the tail of each vector loop
+     *
+     */
+    struct ByteTables {
+        char pair[256];
+        char complement[256];
+        char upper[256];
+        uint8_t code[256];
+        uint8_t valid[256];
+        uint8_t reverseComplement[256];
+
+        ByteTables() {
+            for (int i = 0; i < 256; i++) {
+                pair[i] = ' ';
+                complement[i] = 'N';
+                upper[i] = (char)(i >= 'a' && i <= 'z' ? i - 32 : i);
+                code[i] = 0;
+                valid[i] = 0;
+            }
+            pair['A'] = 'U';
+            pair['T'] = 'A';
+            pair['G'] = 'C';
+            pair['C'] = 'G';
+
+            const char bases[] = "ACGTUacgtu";
+            const char complements[] = "TGCAATGCAA";
+            const uint8_t codes[] = {0, 1, 2, 3, 3, 0, 1, 2, 3, 3};
+            for (size_t i = 0; i < 10; i++) {
+                complement[(uint8_t)bases[i]] = complements[i];
+                code[(uint8_t)bases[i]] = codes[i];
+                valid[(uint8_t)bases[i]] = 1;
+            }
+
+            // reverse the four 2-bit bases of a byte and complement each of them
+            for (int i = 0; i < 256; i++) {
+                uint8_t reversed = 0;
+                for (int j = 0; j < 4; j++) {
+                    uint8_t base = (uint8_t)((i >> (2 * j)) & 3);
+                    reversed = (uint8_t)(reversed | ((3 - base) << (2 * (3 - j))));
+                }
+                reverseComplement[i] = reversed;
+            }
+        }
+    };
+
+    const ByteTables& tables() {
+        static const ByteTables byteTables;
+        return byteTables;
+    }
+
+#ifdef SEQUENCE_KERNELS_SSSE3
+    bool hasSsse3() {
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+    }
+
+    // indexed by the low nibble of a character: 'A' = 1, 'C' = 3, 'T' = 4, 'U' = 5, 'G' = 7.
+    // CANONICAL holds the only character allowed at each nibble; unused slots hold a value that
+    // can never share its own nibble so those inputs always fall through to the default
+    const char PAIR_CANONICAL[16] = {1, 'A', 0, 'C', 'T', 0, 0, 'G', 0, 0, 0, 0, 0, 0, 0, 0};
+    const char PAIR_RESULT[16] = {0, 'U', 0, 'G', 'A', 0, 0, 'C', 0, 0, 0, 0, 0, 0, 0, 0};
+    const char COMPLEMENT_CANONICAL[16] = {1, 'A', 0, 'C', 'T', 'U', 0, 'G', 0, 0, 0, 0, 0, 0, 0, 0};
+    const char COMPLEMENT_RESULT[16] = {0, 'T', 0, 'G', 'A', 'A', 0, 'C', 0, 0, 0, 0, 0, 0, 0, 0};
+
+    __attribute__((target("ssse3")))
+    __m128i lookupNibble(__m128i bytes, __m128i canonical, __m128i result, __m128i fallback) {
+        __m128i nibbles = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+        __m128i matched = _mm_cmpeq_epi8(bytes, _mm_shuffle_epi8(canonical, nibbles));
+        return _mm_or_si128(_mm_and_si128(matched, _mm_shuffle_epi8(result, nibbles)), _mm_andnot_si128(matched, fallback));
+    }
+
+    __m128i foldCase(__m128i bytes) {
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('z' + 1)));
+        return _mm_sub_epi8(bytes, _mm_and_si128(lower, _mm_set1_epi8(32)));
+    }
+
+    __attribute__((target("ssse3")))
+    size_t transcribeSsse3(const char* in, char* out, size_t length) {
+        const __m128i canonical = _mm_loadu_si128((const __m128i*)PAIR_CANONICAL);
+        const __m128i result = _mm_loadu_si128((const __m128i*)PAIR_RESULT);
+        const __m128i fallback = _mm_set1_epi8(' ');
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(in + i));
+            _mm_storeu_si128((__m128i*)(out + i), lookupNibble(bytes, canonical, result, fallback));
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3")))
+    size_t reverseComplementSsse3(const char* in, char* out, size_t length) {
+        const __m128i canonical = _mm_loadu_si128((const __m128i*)COMPLEMENT_CANONICAL);
+        const __m128i result = _mm_loadu_si128((const __m128i*)COMPLEMENT_RESULT);
+        const __m128i fallback = _mm_set1_epi8('N');
+        const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(in + length - i - 16));
+            __m128i complemented = lookupNibble(foldCase(bytes), canonical, result, fallback);
+            _mm_storeu_si128((__m128i*)(out + i), _mm_shuffle_epi8(complemented, reverse));
+        }
+        return i;
+    }
+
+    size_t toUpperCaseSse2(const char* in, char* out, size_t length) {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(in + i));
+            _mm_storeu_si128((__m128i*)(out + i), foldCase(bytes));
+        }
+        return i;
+    }
+#endif
+}
+
+/**
+ * @brief Write the nucleotide pair of every base into a preallocated buffer (same mapping as getPair)
+ *
+ */
+void transcribeSequence(const char* in, char* out, size_t length) {
+    size_t i = 0;
+#ifdef SEQUENCE_KERNELS_SSSE3
+    if (hasSsse3()) {
+        i = transcribeSsse3(in, out, length);
+    }
+#endif
+    const ByteTables& lookup = tables();
+    for (; i < length; i++) {
+        out[i] = lookup.pair[(uint8_t)in[i]];
+    }
+}
+
+/**
+ * @brief Write the reverse complement of a DNA or RNA sequence into a preallocated buffer,
+ * upper case with anything other than A, C, G, T or U mapped to N
+ *
+ */
+void reverseComplement(const char* in, char* out, size_t length) {
+    size_t i = 0;
+#ifdef SEQUENCE_KERNELS_SSSE3
+    if (hasSsse3()) {
+        i = reverseComplementSsse3(in, out, length);
+    }
+#endif
+    const ByteTables& lookup = tables();
+    for (; i < length; i++) {
+        out[i] = lookup.complement[(uint8_t)in[length - 1 - i]];
+    }
+}
+
+/**
+ * @brief Write an upper case copy of the sequence into a preallocated buffer
+ *
+ */
+void toUpperCase(const char* in, char* out, size_t length) {
+    size_t i = 0;
+#ifdef SEQUENCE_KERNELS_SSSE3
+    i = toUpperCaseSse2(in, out, length);
+#endif
+    const ByteTables& lookup = tables();
+    for (; i < length; i++) {
+        out[i] = lookup.upper[(uint8_t)in[i]];
+    }
+}
+
+/**
+ * @brief Get the number of bytes needed to pack the given number of bases at 2 bits per base
+ *
+ * @return size_t
+ */
+size_t getPackedSize(size_t length) {
+    return (length + 3) / 4;
+}
+
+/**
+ * @brief Pack a sequence at 2 bits per base (A = 0, C = 1, G = 2, T/U = 3, first base in the low bits),
+ * storing anything else as A
+ *
+ * @return size_t number of bases that were not A, C, G, T or U
+ */
+size_t packNucleotides(const char* in, uint8_t* out, size_t length) {
+    const ByteTables& lookup = tables();
+    size_t invalid = 0;
+    size_t full = length / 4;
+    for (size_t i = 0; i < full; i++) {
+        const uint8_t* bases = (const uint8_t*)in + 4 * i;
+        out[i] = (uint8_t)(lookup.code[bases[0]] | lookup.code[bases[1]] << 2 | lookup.code[bases[2]] << 4 | lookup.code[bases[3]] << 6);
+        invalid += (size_t)(4 - lookup.valid[bases[0]] - lookup.valid[bases[1]] - lookup.valid[bases[2]] - lookup.valid[bases[3]]);
+    }
+    if (length % 4 != 0) {
+        uint8_t last = 0;
+        for (size_t i = 4 * full; i < length; i++) {
+            last = (uint8_t)(last | lookup.code[(uint8_t)in[i]] << (2 * (i % 4)));
+            invalid += 1 - (size_t)lookup.valid[(uint8_t)in[i]];
+        }
+        out[full] = last;
+    }
+    return invalid;
+}
+
+/**
+ * @brief Unpack 2-bit bases into characters, using U instead of T when rna is set
+ *
+ */
+void unpackNucleotides(const uint8_t* in, char* out, size_t length, bool rna) {
+    const char bases[4] = {'A', 'C', 'G', rna ? 'U' : 'T'};
+    for (size_t i = 0; i < length; i++) {
+        out[i] = bases[(in[i / 4] >> (2 * (i % 4))) & 3];
+    }
+}
+
+/**
+ * @brief Write the nucleotide pair of every packed base into a preallocated packed buffer
+ *
+ */
+void transcribePacked(const uint8_t* in, uint8_t* out, size_t length) {
+    // the pair of code x is 3 - x, which flips both bits of every base
+    size_t bytes = getPackedSize(length);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, in + i, 8);
+        word = ~word;
+        memcpy(out + i, &word, 8);
+    }
+    for (; i < bytes; i++) {
+        out[i] = (uint8_t)~in[i];
+    }
+
+    // keep the unused bits of the last byte clear
+    if (length % 4 != 0) {
+        out[bytes - 1] = (uint8_t)(out[bytes - 1] & ((1 << (2 * (length % 4))) - 1));
+    }
+}
+
+/**
+ * @brief Write the reverse complement of a packed sequence into a preallocated packed buffer
+ *
+ */
+void reverseComplementPacked(const uint8_t* in, uint8_t* out, size_t length) {
+    const ByteTables& lookup = tables();
+    size_t bytes = getPackedSize(length);
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = lookup.reverseComplement[in[bytes - 1 - i]];
+    }
+
+    // the padding of the last input byte is now at the front, shift it out
+    size_t padding = (4 - length % 4) % 4;
+    if (padding != 0) {
+        unsigned shift = (unsigned)(2 * padding);
+        for (size_t i = 0; i + 1 < bytes; i++) {
+            out[i] = (uint8_t)(out[i] >> shift | out[i + 1] << (8 - shift));
+        }
+        out[bytes - 1] = (uint8_t)(out[bytes - 1] >> shift);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef SEQUENCE_KERNELS_H
+#define SEQUENCE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Write the nucleotide pair of every base into a preallocated buffer (same mapping as getPair)
+ *
+ */
+void transcribeSequence(const char*, char*, size_t);
+
+/**
+ * @brief Write the reverse complement of a DNA or RNA sequence into a preallocated buffer,
+ * upper case with anything other than A, C, G, T or U mapped to N
+ *
+ */
+void reverseComplement(const char*, char*, size_t);
+
+/**
+ * @brief Write an upper case copy of the sequence into a preallocated buffer
+ *
+ */
+void toUpperCase(const char*, char*, size_t);
+
+/**
+ * @brief Get the number of bytes needed to pack the given number of bases at 2 bits per base
+ *
+ * @return size_t
+ */
+size_t getPackedSize(size_t);
+
+/**
+ * @brief Pack a sequence at 2 bits per base (A = 0, C = 1, G = 2, T/U = 3, first base in the low bits),
+ * storing anything else as A
+ *
+ * @return size_t number of bases that were not A, C, G, T or U
+ */
+size_t packNucleotides(const char*, uint8_t*, size_t);
+
+/**
+ * @brief Unpack 2-bit bases into characters, using U instead of T when rna is set
+ *
+ */
+void unpackNucleotides(const uint8_t*, char*, size_t, bool);
+
+/**
+ * @brief Write the nucleotide pair of every packed base into a preallocated packed buffer
+ *
+ */
+void transcribePacked(const uint8_t*, uint8_t*, size_t);
+
+/**
+ * @brief Write the reverse complement of a packed sequence into a preallocated packed buffer
+ *
+ */
+void reverseComplementPacked(const uint8_t*, uint8_t*, size_t);
+
+#endif